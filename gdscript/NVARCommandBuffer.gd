@@ -0,0 +1,97 @@
+# Packs GodotNVAR setter calls into a single PoolByteArray for submit_commands,
+# so a frame of updates costs one native call instead of one per setter.
+# Opcodes and layouts must match src/CommandBuffer.h.
+#
+#     var commands = NVARCommandBuffer.new()
+#     commands.set_listener_location(camera.global_transform.origin)
+#     commands.set_source_location(source_id, emitter.global_transform.origin)
+#     commands.trace()
+#     nvar.submit_commands(commands.get_data())
+#     commands.clear()
+extends Reference
+class_name NVARCommandBuffer
+
+const SET_LISTENER_LOCATION = 1
+const SET_LISTENER_ORIENTATION = 2
+const SET_SOURCE_LOCATION = 3
+const SET_SOURCE_DIRECT_GAIN = 4
+const SET_SOURCE_INDIRECT_GAIN = 5
+const SET_MESH_TRANSFORM = 6
+const SET_MATERIAL_REFLECTION = 7
+const SET_MATERIAL_TRANSMISSION = 8
+const COMMIT_GEOMETRY = 9
+const TRACE = 10
+
+var _buffer = StreamPeerBuffer.new()
+
+
+func set_listener_location(location: Vector3) -> void:
+	_buffer.put_u8(SET_LISTENER_LOCATION)
+	_put_vector3(location)
+
+
+func set_listener_orientation(forward: Vector3, up: Vector3) -> void:
+	_buffer.put_u8(SET_LISTENER_ORIENTATION)
+	_put_vector3(forward)
+	_put_vector3(up)
+
+
+func set_source_location(source_id: int, location: Vector3) -> void:
+	_buffer.put_u8(SET_SOURCE_LOCATION)
+	_buffer.put_64(source_id)
+	_put_vector3(location)
+
+
+func set_source_direct_gain(source_id: int, gain: float) -> void:
+	_buffer.put_u8(SET_SOURCE_DIRECT_GAIN)
+	_buffer.put_64(source_id)
+	_buffer.put_float(gain)
+
+
+func set_source_indirect_gain(source_id: int, gain: float) -> void:
+	_buffer.put_u8(SET_SOURCE_INDIRECT_GAIN)
+	_buffer.put_64(source_id)
+	_buffer.put_float(gain)
+
+
+func set_mesh_transform(mesh_id: int, transform: Transform) -> void:
+	_buffer.put_u8(SET_MESH_TRANSFORM)
+	_buffer.put_64(mesh_id)
+	# basis rows, then origin, matching Basis.elements in the native code
+	var basis = transform.basis
+	_put_vector3(Vector3(basis.x.x, basis.y.x, basis.z.x))
+	_put_vector3(Vector3(basis.x.y, basis.y.y, basis.z.y))
+	_put_vector3(Vector3(basis.x.z, basis.y.z, basis.z.z))
+	_put_vector3(transform.origin)
+
+
+func set_material_reflection(material_id: int, reflection: float) -> void:
+	_buffer.put_u8(SET_MATERIAL_REFLECTION)
+	_buffer.put_64(material_id)
+	_buffer.put_float(reflection)
+
+
+func set_material_transmission(material_id: int, transmission: float) -> void:
+	_buffer.put_u8(SET_MATERIAL_TRANSMISSION)
+	_buffer.put_64(material_id)
+	_buffer.put_float(transmission)
+
+
+func commit_geometry() -> void:
+	_buffer.put_u8(COMMIT_GEOMETRY)
+
+
+func trace() -> void:
+	_buffer.put_u8(TRACE)
+
+
+func get_data() -> PoolByteArray:
+	return _buffer.data_array
+
+
+func is_empty() -> bool:
+	return _buffer.get_size() == 0
+
+
+func clear() -> void:
+	_buffer.clear()
@@ -0,0 +1,884 @@
+#ifndef GODOTNVAR_AUDIO_RENDERER_H
+#define GODOTNVAR_AUDIO_RENDERER_H
+
+#include "nvar.h"
+#include "FilterBuilder.h"
+#include "dsp/AlignedBuffer.h"
+#include "dsp/PartitionedConvolver.h"
+#include "dsp/RingBuffer.h"
+#include "dsp/TapDelay.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/** Renders every attached source through NVAR on a dedicated audio thread.
+ *
+ *  Mono input is pushed per source from the main thread into lock-free FIFOs.
+ *  The audio thread renders fixed size blocks into preallocated aligned
+ *  buffers and writes the stereo mix to an output FIFO,
+ *  which the main thread drains into an AudioStreamGeneratorPlayback. The
+ *  audio thread never locks or allocates; sources are handed over through a
+ *  fixed table of voices with atomic states.
+ */
+class AudioRenderer {
+public:
+    static const int kChannels = 2;
+    static const int kMaxVoices = 256;
+
+    /** How sources are filtered on the audio thread **/
+    enum MixMode {
+        MIX_PER_SOURCE = 0,  // nvarApplySourceFilters for every source
+        MIX_BATCHED = 1,     // direct path per source, indirect paths submitted and mixed in one call
+        MIX_CONVOLVER = 2,   // filters from nvarGetSourceFilters run through our own partitioned convolver
+        MIX_CONVOLVER_NONUNIFORM = 3,   // as above, with the filter tail in long partitions on a worker thread
+    };
+
+    /** Tail partition of the non-uniform convolver, in blocks **/
+    static const int kTailBlocks = 16;
+
+    /** Length of the latest filters built for a source in a convolver mode **/
+    struct FilterStats {
+        int fullLength;   // per-channel taps returned by nvarGetSourceFilters
+        int length;       // taps left after energy truncation
+        int builds;       // filter sets built since the source was attached
+        int taps;         // early reflection taps rendered by the tap delay line, both channels
+        int tapLength;    // filter taps the tap delay line covers, per channel
+    };
+
+    /** Level of detail a voice is rendered at, cheapest last **/
+    enum SourceLod {
+        LOD_FULL = 0,     // direct and indirect paths as the mix mode renders them
+        LOD_DIRECT = 1,   // nvarApplySourceDirectPathFilter only
+        LOD_PANNED = 2,   // pan, gain and one-pole low-pass on the CPU, no NVAR filtering
+        LOD_COUNT = 3,
+    };
+
+    /** Parameters of a LOD_PANNED voice **/
+    struct PanSettings {
+        float left;      // gain of the left channel, pan law included
+        float right;
+        float lowpass;   // one-pole coefficient in (0, 1], 1 passes everything
+    };
+
+    AudioRenderer() : nvar(NULL), mixMode(MIX_BATCHED), blockSize(0), sampleRate(0), filterLength(0),
+                      earlyWindow(0.08f), earlyLength(0),
+                      inputCapacity(0), running(false), stopping(false), underruns(0), renderedFrames(0), voiceCount(0),
+                      silence(), tailPhase(0), tailPosted(0), tailDone(0) {
+        for (int i = 0; i < kMaxVoices; i++) {
+            voices[i].state.store(VOICE_FREE);
+            voices[i].source = NULL;
+            voices[i].current = nullptr;
+            voices[i].pending.store(nullptr);
+            voices[i].generation.store(0);
+            voices[i].stats = FilterStats();
+            voices[i].tailSet = nullptr;
+            voices[i].tailFrom = nullptr;
+            voices[i].inTail = false;
+            voices[i].tailFading = false;
+            voices[i].tailJoined = false;
+            voices[i].lod.store(LOD_FULL);
+            voices[i].activeLod = LOD_FULL;
+        }
+        for (int lod = 0; lod < LOD_COUNT; lod++) {
+            lodNanos[lod].store(0);
+            lodBlocks[lod].store(0);
+        }
+    }
+
+    ~AudioRenderer() {
+        stop();
+    }
+
+    /** Allocates all buffers and starts the audio thread. bufferSeconds is
+     *  the size of each FIFO, which bounds the latency of the output.
+     *  filterLength is the per-channel length of the source filters, used to
+     *  size the convolvers.
+     */
+    void start(nvar_t nvar, int blockSize, int sampleRate, float bufferSeconds, int filterLength) {
+        stop();
+        this->nvar = nvar;
+        this->blockSize = blockSize;
+        this->sampleRate = sampleRate;
+        this->filterLength = filterLength;
+        int bufferFrames = std::max(4 * blockSize, (int)(bufferSeconds * sampleRate));
+        inputCapacity = bufferFrames;
+        output.init(bufferFrames * kChannels);
+        for (int ch = 0; ch < kChannels; ch++) {
+            scratch[ch].allocate(blockSize);
+            mix[ch].allocate(blockSize);
+            fadeFrom[ch].allocate(blockSize);
+            fadeTo[ch].allocate(blockSize);
+        }
+        interleaved.allocate((size_t)blockSize * kChannels);
+        underruns.store(0);
+        for (int lod = 0; lod < LOD_COUNT; lod++) {
+            lodNanos[lod].store(0);
+            lodBlocks[lod].store(0);
+        }
+        retired.init(2 * kMaxVoices);
+        bool nonUniform = getMixMode() == MIX_CONVOLVER_NONUNIFORM;
+        int earlyBlocks = (int)std::ceil(earlyWindow * sampleRate / blockSize);
+        earlyLength = std::min(earlyBlocks * blockSize, filterLength);
+        if (isConvolverMode(getMixMode()) && supportsConvolver()) {
+            builder.start(blockSize, nonUniform ? getTailSize() : 0, earlyLength,
+                          [this](int voice, uint32_t generation, FilterSet* filters) {
+                publishFilters(voice, generation, filters);
+            });
+        }
+
+        stopping.store(false);
+        running = true;
+        tailPhase = 0;
+        tailPosted.store(0);
+        tailDone.store(0);
+        if (nonUniform) {
+            tailThread = std::thread(&AudioRenderer::tailLoop, this);
+        }
+        thread = std::thread(&AudioRenderer::renderLoop, this);
+    }
+
+    /** Stops the audio thread and detaches every source **/
+    void stop() {
+        if (!running) {
+            return;
+        }
+        stopping.store(true);
+        thread.join();
+        if (tailThread.joinable()) {
+            tailWake.notify_all();
+            tailThread.join();
+        }
+        builder.stop();
+        running = false;
+        for (int i = 0; i < kMaxVoices; i++) {
+            voices[i].state.store(VOICE_FREE);
+            voices[i].source = NULL;
+            releaseFilters(voices[i]);
+        }
+        collectRetired();
+        voiceBySource.clear();
+        voiceCount.store(0);
+        // detached sources are released too, whatever their voice is used for next
+        for (size_t i = 0; i < detached.size(); i++) {
+            detached[i].second = -1;
+        }
+    }
+
+    bool isRunning() const { return running; }
+    int getBlockSize() const { return blockSize; }
+    int getSampleRate() const { return sampleRate; }
+    int getUnderruns() const { return underruns.load(); }
+    int getInputCapacity() const { return inputCapacity; }
+    /** Frames rendered since the renderer was created, the audio clock **/
+    int64_t getRenderedFrames() const { return renderedFrames.load(std::memory_order_relaxed); }
+
+    /** The convolver runs one partition per block, so it needs a power of two block size **/
+    bool supportsConvolver() const { return blockSize >= 32 && (blockSize & (blockSize - 1)) == 0; }
+
+    static bool isConvolverMode(int mode) { return mode == MIX_CONVOLVER || mode == MIX_CONVOLVER_NONUNIFORM; }
+
+    /** Selects the mix mode. NVAR modes can be switched while running and take
+     *  effect on the next block; convolver modes can only be entered or left
+     *  while stopped, since their buffers are allocated when sources attach.
+     */
+    bool setMixMode(MixMode mode) {
+        MixMode previous = getMixMode();
+        if (running && mode != previous && (isConvolverMode(mode) || isConvolverMode(previous))) {
+            return false;
+        }
+        mixMode.store(mode);
+        return true;
+    }
+    MixMode getMixMode() const { return (MixMode)mixMode.load(); }
+
+    /** Starts rendering a source. Makes the preallocation call for the block
+     *  size before the audio thread can see the source.
+     */
+    nvarStatus_t attach(nvarSource_t source) {
+        if (!running || voiceBySource.count(source) > 0) {
+            return NVAR_STATUS_INVALID_VALUE;
+        }
+        settleDetached();
+        int index = -1;
+        for (int i = 0; i < kMaxVoices; i++) {
+            if (voices[i].state.load(std::memory_order_acquire) == VOICE_FREE) {
+                index = i;
+                break;
+            }
+        }
+        if (index < 0) {
+            return NVAR_STATUS_OUT_OF_RESOURCES;
+        }
+
+        nvarStatus_t nvarStatus = nvarApplySourceFilters(source, NULL, NULL, blockSize);
+        if (nvarStatus != NVAR_STATUS_SUCCESS) {
+            return nvarStatus;
+        }
+        Voice& voice = voices[index];
+        voice.source = source;
+        if (voice.block.size() < (size_t)blockSize) {
+            voice.block.allocate(blockSize);
+        }
+        if (voice.input.capacity() < inputCapacity) {
+            voice.input.init(inputCapacity);
+        } else {
+            voice.input.discard();
+        }
+        if (getMixMode() == MIX_CONVOLVER) {
+            int partitions = std::max(1, (filterLength + blockSize - 1) / blockSize);
+            if (voice.convolver.getPartitionSize() != blockSize || voice.convolver.getMaxPartitions() < partitions) {
+                voice.convolver.init(blockSize, partitions);
+            } else {
+                voice.convolver.reset();
+            }
+        } else if (getMixMode() == MIX_CONVOLVER_NONUNIFORM) {
+            voice.nonUniform.init(blockSize, getTailSize(), kChannels, filterLength);
+            voice.tailJoined = false;
+        }
+        if (isConvolverMode(getMixMode()) && earlyLength > 0) {
+            if (voice.early.getMaxDelay() != earlyLength) {
+                voice.early.init(blockSize, earlyLength);
+            } else {
+                voice.early.reset();
+            }
+        }
+        voice.lod.store(LOD_FULL, std::memory_order_relaxed);
+        voice.activeLod = LOD_FULL;
+        voiceBySource[source] = index;
+        if (index >= voiceCount.load()) {
+            voiceCount.store(index + 1, std::memory_order_release);
+        }
+        voice.state.store(VOICE_ACTIVE, std::memory_order_release);
+        return NVAR_STATUS_SUCCESS;
+    }
+
+    /** Stops rendering a source without waiting for the audio thread to let
+     *  go of it. The source must not be destroyed before takeReleased has
+     *  returned it.
+     */
+    void detach(nvarSource_t source) {
+        std::unordered_map<nvarSource_t, int>::iterator it = voiceBySource.find(source);
+        if (it == voiceBySource.end()) {
+            return;
+        }
+        voices[it->second].state.store(VOICE_RETIRING, std::memory_order_release);
+        detached.push_back(std::make_pair(source, it->second));
+        voiceBySource.erase(it);
+    }
+
+    /** Appends the detached sources the audio thread has let go of, which
+     *  can now be destroyed.
+     */
+    void takeReleased(std::vector<nvarSource_t>& sources) {
+        settleDetached();
+        size_t kept = 0;
+        for (size_t i = 0; i < detached.size(); i++) {
+            if (detached[i].second >= 0) {
+                detached[kept++] = detached[i];
+            } else {
+                sources.push_back(detached[i].first);
+            }
+        }
+        detached.resize(kept);
+    }
+
+    bool isAttached(nvarSource_t source) const {
+        return voiceBySource.count(source) > 0;
+    }
+
+    /** Length in seconds of the start of each filter searched for sparse
+     *  early reflections, which the convolver modes render as a multi-tap
+     *  delay line instead of convolving. 0 disables it. Takes effect on the
+     *  next start().
+     */
+    void setEarlyWindow(float seconds) { earlyWindow = std::max(seconds, 0.0f); }
+    float getEarlyWindow() const { return earlyWindow; }
+
+    /** See FilterBuilder::setTruncationFloor **/
+    void setTruncationFloor(float floorDb) { builder.setTruncationFloor(floorDb); }
+    float getTruncationFloor() const { return builder.getTruncationFloor(); }
+
+    /** Returns false if the source is not attached **/
+    bool getFilterStats(nvarSource_t source, FilterStats& stats) {
+        std::unordered_map<nvarSource_t, int>::iterator it = voiceBySource.find(source);
+        if (it == voiceBySource.end()) {
+            return false;
+        }
+        std::lock_guard<std::mutex> guard(publishLock);
+        stats = voices[it->second].stats;
+        return true;
+    }
+
+    /** Selects the level of detail of a source. pan is only used by
+     *  LOD_PANNED and can be updated every frame. The audio thread switches
+     *  on its next block with a one block crossfade; a voice returning to
+     *  LOD_FULL in the non-uniform mode waits for the tail worker to let go
+     *  of it first. Returns false if the source is not attached.
+     */
+    bool setSourceLod(nvarSource_t source, SourceLod lod, const PanSettings& pan) {
+        std::unordered_map<nvarSource_t, int>::iterator it = voiceBySource.find(source);
+        if (it == voiceBySource.end()) {
+            return false;
+        }
+        Voice& voice = voices[it->second];
+        voice.panLeft.store(pan.left, std::memory_order_relaxed);
+        voice.panRight.store(pan.right, std::memory_order_relaxed);
+        voice.panLowpass.store(std::min(std::max(pan.lowpass, 1e-4f), 1.0f), std::memory_order_relaxed);
+        voice.lod.store(lod, std::memory_order_release);
+        return true;
+    }
+
+    /** Audio thread time spent per level of detail since start, in
+     *  nanoseconds, and the voice blocks it covers. The batched indirect mix
+     *  and the non-uniform tail worker are counted toward LOD_FULL.
+     */
+    void getLodCosts(int64_t nanos[LOD_COUNT], int64_t blocks[LOD_COUNT]) const {
+        for (int lod = 0; lod < LOD_COUNT; lod++) {
+            nanos[lod] = lodNanos[lod].load(std::memory_order_relaxed);
+            blocks[lod] = lodBlocks[lod].load(std::memory_order_relaxed);
+        }
+    }
+
+    /** Queues mono input for a source. Returns the number of samples accepted. **/
+    int pushInput(nvarSource_t source, const float* samples, int count) {
+        std::unordered_map<nvarSource_t, int>::iterator it = voiceBySource.find(source);
+        if (it == voiceBySource.end()) {
+            return 0;
+        }
+        return voices[it->second].input.write(samples, count);
+    }
+
+    /** Input space left for a source, in samples **/
+    int getInputSpace(nvarSource_t source) {
+        std::unordered_map<nvarSource_t, int>::iterator it = voiceBySource.find(source);
+        return it == voiceBySource.end() ? 0 : voices[it->second].input.writeAvailable();
+    }
+
+    /** Rendered stereo frames ready to be pulled **/
+    int getFramesAvailable() const {
+        return output.readAvailable() / kChannels;
+    }
+
+    /** Reads up to maxFrames interleaved stereo frames. Returns frames read. **/
+    int pull(float* out, int maxFrames) {
+        collectRetired();
+        int frames = std::min(maxFrames, getFramesAvailable());
+        return output.read(out, frames * kChannels) / kChannels;
+    }
+
+    /** Fetches the latest filters of every attached source and queues them
+     *  for the builder thread. Call after a trace completes, in convolver
+     *  mode only. Sources whose filters are not ready keep their current ones.
+     */
+    void updateFilters() {
+        collectRetired();
+        if (!builder.isRunning() || !isConvolverMode(getMixMode())) {
+            return;
+        }
+        int sizeBytes = 0;
+        if (nvarGetSourceFilterArraySize(nvar, &sizeBytes) != NVAR_STATUS_SUCCESS || sizeBytes <= 0) {
+            return;
+        }
+        int perChannel = sizeBytes / (int)sizeof(float) / kChannels;
+        if (perChannel > filterLength) {
+            // the convolvers would drop the partitions past the length they were sized for
+            return;
+        }
+        for (std::unordered_map<nvarSource_t, int>::iterator it = voiceBySource.begin(); it != voiceBySource.end(); ++it) {
+            std::vector<float> filterArray(sizeBytes / sizeof(float));
+            if (nvarGetSourceFilters(it->first, filterArray.data()) != NVAR_STATUS_SUCCESS) {
+                continue;
+            }
+            Voice& voice = voices[it->second];
+            builder.submit(it->second, voice.generation.load(), filterArray, perChannel);
+        }
+    }
+
+private:
+    enum VoiceState {
+        VOICE_FREE = 0,
+        VOICE_ACTIVE = 1,
+        VOICE_RETIRING = 2,
+    };
+
+    struct Voice {
+        std::atomic<int> state;
+        nvarSource_t source;
+        dsp::RingBuffer input;
+        dsp::AlignedBuffer block;   // stays valid until the submitted buffers are mixed
+
+        // convolver mode
+        dsp::UniformConvolver convolver;
+        FilterSet* current;                 // audio thread only
+        std::atomic<FilterSet*> pending;    // newest set from the builder, taken by the audio thread
+        std::atomic<uint32_t> generation;   // bumped on attach and detach to drop stale builds
+        FilterStats stats;                  // guarded by publishLock
+        dsp::MultiTapDelay early;           // sparse early reflections, both convolver modes
+
+        // non-uniform convolver mode, audio thread unless noted
+        dsp::NonUniformConvolver nonUniform;
+        FilterSet* tailSet;   // set the tail worker filters with, may lag behind current
+        FilterSet* tailFrom;  // set the tail crossfades from, kept until the next change
+        bool inTail;          // part of the latest tail period handed to the worker
+        bool tailFading;      // the tail worker crossfades from tailFrom this period
+        bool tailJoined;      // aligned with the global tail period
+
+        // level of detail
+        std::atomic<int> lod;             // requested by the main thread
+        std::atomic<float> panLeft;       // LOD_PANNED targets from the main thread
+        std::atomic<float> panRight;
+        std::atomic<float> panLowpass;
+        int activeLod;                    // audio thread only
+        float gainLeft;                   // LOD_PANNED gains reached, ramped toward the targets
+        float gainRight;
+        float lowpassState;
+    };
+
+    int getTailSize() const { return kTailBlocks * blockSize; }
+
+    /** Builder thread. Hands a finished set to the audio thread unless the
+     *  voice was detached or reused since the filters were fetched.
+     */
+    void publishFilters(int index, uint32_t generation, FilterSet* filters) {
+        std::lock_guard<std::mutex> guard(publishLock);
+        Voice& voice = voices[index];
+        if (voice.generation.load() != generation) {
+            delete filters;
+            return;
+        }
+        voice.stats.fullLength = filters->fullLength;
+        voice.stats.length = filters->length;
+        voice.stats.builds++;
+        voice.stats.taps = (int)(filters->taps[0].taps.size() + filters->taps[1].taps.size());
+        voice.stats.tapLength = std::max(filters->taps[0].length, filters->taps[1].length);
+        // a set the audio thread never picked up is simply replaced
+        delete voice.pending.exchange(filters, std::memory_order_acq_rel);
+    }
+
+    /** Cleans up the voices of detached sources the audio thread has let
+     *  go of, before attach can hand the voices out again.
+     */
+    void settleDetached() {
+        for (size_t i = 0; i < detached.size(); i++) {
+            if (detached[i].second < 0) {
+                continue;
+            }
+            Voice& voice = voices[detached[i].second];
+            if (voice.state.load(std::memory_order_acquire) == VOICE_FREE) {
+                voice.source = NULL;
+                releaseFilters(voice);
+                detached[i].second = -1;
+            }
+        }
+    }
+
+    /** Main thread, once the audio thread has let go of the voice **/
+    void releaseFilters(Voice& voice) {
+        {
+            std::lock_guard<std::mutex> guard(publishLock);
+            voice.generation++;
+            voice.stats = FilterStats();
+            delete voice.pending.exchange(nullptr, std::memory_order_acq_rel);
+        }
+        if (voice.tailFrom != voice.current && voice.tailFrom != voice.tailSet) {
+            delete voice.tailFrom;
+        }
+        if (voice.tailSet != voice.current) {
+            delete voice.tailSet;
+        }
+        voice.tailFrom = nullptr;
+        voice.tailSet = nullptr;
+        delete voice.current;
+        voice.current = nullptr;
+    }
+
+    /** Main thread. Frees the sets the audio thread has swapped out. **/
+    void collectRetired() {
+        FilterSet* filters = nullptr;
+        while (retired.read(&filters, 1) == 1) {
+            delete filters;
+        }
+    }
+
+    /** Audio thread. Swaps in the newest set, if any, and returns the set
+     *  to crossfade from in this block: the old one, silence for the first
+     *  set, or null if nothing changed. Pass it to retireFilters once the
+     *  block is rendered.
+     */
+    FilterSet* takePendingFilters(Voice& voice) {
+        // checking for room here guarantees retireFilters can hand the old set back
+        if (voice.pending.load(std::memory_order_relaxed) == nullptr || retired.writeAvailable() == 0) {
+            return nullptr;
+        }
+        FilterSet* previous = voice.current;
+        voice.current = voice.pending.exchange(nullptr, std::memory_order_acq_rel);
+        return previous ? previous : &silence;
+    }
+
+    /** Audio thread. Hands a replaced set back to the main thread, unless
+     *  the tail worker still uses it; the tail boundary retires those.
+     */
+    void retireFilters(Voice& voice, FilterSet* previous) {
+        if (previous && previous != &silence && previous != voice.tailSet && previous != voice.tailFrom) {
+            retired.write(&previous, 1);
+        }
+    }
+
+    bool isTailIdle() const {
+        return tailDone.load(std::memory_order_acquire) == tailPosted.load(std::memory_order_relaxed);
+    }
+
+    /** The block that ends a tail period hands work to the tail worker, which
+     *  must have finished the previous period by then.
+     */
+    bool canRenderBlock() const {
+        return mixMode.load() != MIX_CONVOLVER_NONUNIFORM || tailPhase + 1 < kTailBlocks || isTailIdle();
+    }
+
+    /** Audio thread, at the end of a tail period. The worker is idle. **/
+    void postTail() {
+        int count = voiceCount.load(std::memory_order_acquire);
+        for (int i = 0; i < count; i++) {
+            Voice& voice = voices[i];
+            voice.inTail = false;
+            if (voice.state.load(std::memory_order_acquire) != VOICE_ACTIVE || !voice.tailJoined) {
+                continue;
+            }
+            voice.tailFading = false;
+            if (voice.tailSet != voice.current && retired.writeAvailable() > 0) {
+                // crossfade the tail over this period; the set faded from last time is done
+                FilterSet* stale = voice.tailFrom;
+                voice.tailFrom = voice.tailSet;
+                voice.tailSet = voice.current;
+                voice.tailFading = true;
+                if (stale && stale != voice.tailFrom && stale != voice.tailSet) {
+                    retired.write(&stale, 1);
+                }
+            }
+            voice.nonUniform.beginTail();
+            voice.inTail = true;
+        }
+        tailPhase = 0;
+        tailPosted.fetch_add(1, std::memory_order_release);
+        tailWake.notify_one();
+    }
+
+    /** Tail worker. Filters the tail block of every voice in the posted period. **/
+    void tailLoop() {
+        uint64_t seen = 0;
+        std::mutex waitLock;
+        while (!stopping.load()) {
+            uint64_t posted = tailPosted.load(std::memory_order_acquire);
+            if (posted == seen) {
+                // the audio thread never locks, so a missed notify is caught by the timeout
+                std::unique_lock<std::mutex> guard(waitLock);
+                tailWake.wait_for(guard, std::chrono::milliseconds(1));
+                continue;
+            }
+            std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+            int count = voiceCount.load(std::memory_order_acquire);
+            for (int i = 0; i < count; i++) {
+                Voice& voice = voices[i];
+                if (!voice.inTail) {
+                    continue;
+                }
+                const dsp::FilterSpectrum* fadeFrom = nullptr;
+                if (voice.tailFading) {
+                    fadeFrom = voice.tailFrom ? voice.tailFrom->tail : silence.tail;
+                }
+                voice.nonUniform.processTail(voice.tailSet ? voice.tailSet->tail : nullptr, fadeFrom);
+            }
+            lodNanos[LOD_FULL].fetch_add(elapsedNanos(started), std::memory_order_relaxed);
+            seen = posted;
+            tailDone.store(posted, std::memory_order_release);
+        }
+    }
+
+    void renderLoop() {
+        std::chrono::microseconds idle((int64_t)500000 * blockSize / sampleRate);
+        while (!stopping.load()) {
+            releaseRetired();
+            if (output.writeAvailable() < blockSize * kChannels || !canRenderBlock()) {
+                std::this_thread::sleep_for(idle);
+                continue;
+            }
+            renderBlock();
+        }
+    }
+
+    /** Acknowledges voices the main thread has detached **/
+    void releaseRetired() {
+        int count = voiceCount.load(std::memory_order_acquire);
+        for (int i = 0; i < count; i++) {
+            if (voices[i].state.load(std::memory_order_acquire) != VOICE_RETIRING) {
+                continue;
+            }
+            // keep the voice until the tail worker is done with it
+            if (voices[i].inTail && !isTailIdle()) {
+                continue;
+            }
+            voices[i].state.store(VOICE_FREE, std::memory_order_release);
+        }
+    }
+
+    void renderBlock() {
+        float* outputs[kChannels] = { scratch[0].get(), scratch[1].get() };
+        float* targets[kChannels] = { mix[0].get(), mix[1].get() };
+        int mode = mixMode.load();
+        bool submitted = false;
+        mix[0].clear();
+        mix[1].clear();
+
+        int count = voiceCount.load(std::memory_order_acquire);
+        for (int i = 0; i < count; i++) {
+            Voice& voice = voices[i];
+            if (voice.state.load(std::memory_order_acquire) != VOICE_ACTIVE) {
+                continue;
+            }
+            float* in = voice.block.get();
+            int read = voice.input.read(in, blockSize);
+            if (read < blockSize) {
+                // the game fell behind, pad with silence rather than stall
+                std::fill(in + read, in + blockSize, 0.0f);
+                if (read > 0) {
+                    underruns++;
+                }
+            }
+
+            std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+            int lod = voice.lod.load(std::memory_order_acquire);
+            if (lod != voice.activeLod && canEnterLod(voice, mode, lod)) {
+                // render both levels once and crossfade, so the switch does not click
+                float* from[kChannels] = { fadeFrom[0].get(), fadeFrom[1].get() };
+                float* to[kChannels] = { fadeTo[0].get(), fadeTo[1].get() };
+                for (int ch = 0; ch < kChannels; ch++) {
+                    fadeFrom[ch].clear();
+                    fadeTo[ch].clear();
+                }
+                renderLod(voice, mode, voice.activeLod, in, from, outputs, submitted);
+                leaveLod(voice, mode, voice.activeLod);
+                enterLod(voice, mode, lod);
+                renderLod(voice, mode, lod, in, to, outputs, submitted);
+                for (int ch = 0; ch < kChannels; ch++) {
+                    dsp::crossfadeAccumulate(from[ch], to[ch], targets[ch], blockSize);
+                }
+                voice.activeLod = lod;
+            } else {
+                renderLod(voice, mode, voice.activeLod, in, targets, outputs, submitted);
+            }
+            lodNanos[voice.activeLod].fetch_add(elapsedNanos(started), std::memory_order_relaxed);
+            lodBlocks[voice.activeLod].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (submitted) {
+            std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+            if (nvarApplyIndirectPathFiltersToSubmittedBuffers(nvar, outputs, blockSize) == NVAR_STATUS_SUCCESS) {
+                accumulate(outputs, targets);
+            }
+            lodNanos[LOD_FULL].fetch_add(elapsedNanos(started), std::memory_order_relaxed);
+        }
+        if (mode == MIX_CONVOLVER_NONUNIFORM && ++tailPhase == kTailBlocks) {
+            postTail();
+        }
+
+        float* frames = interleaved.get();
+        for (int n = 0; n < blockSize; n++) {
+            frames[2 * n] = mix[0][n];
+            frames[2 * n + 1] = mix[1][n];
+        }
+        output.write(frames, blockSize * kChannels);
+        renderedFrames.fetch_add(blockSize, std::memory_order_relaxed);
+    }
+
+    /** Renders one block of a voice at a level of detail into targets. In
+     *  the batched mode the indirect paths of LOD_FULL voices are submitted
+     *  and mixed later, so they switch without a crossfade.
+     */
+    void renderLod(Voice& voice, int mode, int lod, float* in, float* const* targets, float** outputs,
+                   bool& submitted) {
+        if (lod == LOD_PANNED) {
+            renderPanned(voice, in, targets);
+        } else if (lod == LOD_DIRECT) {
+            if (nvarApplySourceDirectPathFilter(voice.source, outputs, in, blockSize) == NVAR_STATUS_SUCCESS) {
+                accumulate(outputs, targets);
+            }
+        } else if (mode == MIX_CONVOLVER) {
+            FilterSet* previous = takePendingFilters(voice);
+            voice.convolver.pushInput(in);
+            if (voice.current) {
+                for (int ch = 0; ch < kChannels; ch++) {
+                    if (previous) {
+                        voice.convolver.crossfade(previous->spectrum[ch], voice.current->spectrum[ch], targets[ch]);
+                    } else {
+                        voice.convolver.convolve(voice.current->spectrum[ch], targets[ch], true);
+                    }
+                }
+            }
+            renderTaps(voice, in, previous, targets);
+            retireFilters(voice, previous);
+        } else if (mode == MIX_CONVOLVER_NONUNIFORM) {
+            FilterSet* previous = takePendingFilters(voice);
+            if (!voice.tailJoined) {
+                voice.nonUniform.skipBlocks(tailPhase);
+                voice.tailJoined = true;
+            }
+            voice.nonUniform.process(in, voice.current ? voice.current->spectrum : nullptr,
+                                     previous ? previous->spectrum : nullptr, targets);
+            renderTaps(voice, in, previous, targets);
+            retireFilters(voice, previous);
+        } else if (mode == MIX_BATCHED) {
+            if (nvarApplySourceDirectPathFilter(voice.source, outputs, in, blockSize) == NVAR_STATUS_SUCCESS) {
+                accumulate(outputs, targets);
+            }
+            submitted |= nvarSourceSubmitBuffers(voice.source, in, blockSize) == NVAR_STATUS_SUCCESS;
+        } else if (nvarApplySourceFilters(voice.source, outputs, in, blockSize) == NVAR_STATUS_SUCCESS) {
+            accumulate(outputs, targets);
+        }
+    }
+
+    /** A voice leaving LOD_FULL in the non-uniform mode can only come back
+     *  once the tail worker no longer holds it, since its convolver restarts.
+     */
+    bool canEnterLod(const Voice& voice, int mode, int lod) const {
+        return lod != LOD_FULL || mode != MIX_CONVOLVER_NONUNIFORM || !voice.inTail;
+    }
+
+    void leaveLod(Voice& voice, int mode, int lod) {
+        if (lod == LOD_FULL && mode == MIX_CONVOLVER_NONUNIFORM) {
+            // out of the next tail period; the worker may still finish the posted one
+            voice.tailJoined = false;
+        }
+    }
+
+    /** Convolver history is stale after a voice skipped full rendering, so it starts over **/
+    void enterLod(Voice& voice, int mode, int lod) {
+        if (lod == LOD_PANNED) {
+            voice.gainLeft = voice.panLeft.load(std::memory_order_relaxed);
+            voice.gainRight = voice.panRight.load(std::memory_order_relaxed);
+            voice.lowpassState = 0.0f;
+        } else if (lod == LOD_FULL && mode == MIX_CONVOLVER) {
+            voice.convolver.reset();
+            voice.early.reset();
+        } else if (lod == LOD_FULL && mode == MIX_CONVOLVER_NONUNIFORM) {
+            voice.nonUniform.reset();
+            voice.early.reset();
+        }
+    }
+
+    /** Adds a voice's input to targets through a one-pole low-pass and a
+     *  stereo gain, ramping the gains over the block to avoid zipper noise.
+     */
+    void renderPanned(Voice& voice, const float* in, float* const* targets) {
+        float left = voice.panLeft.load(std::memory_order_relaxed);
+        float right = voice.panRight.load(std::memory_order_relaxed);
+        float a = voice.panLowpass.load(std::memory_order_relaxed);
+        float stepLeft = (left - voice.gainLeft) / blockSize;
+        float stepRight = (right - voice.gainRight) / blockSize;
+        float gainLeft = voice.gainLeft;
+        float gainRight = voice.gainRight;
+        float y = voice.lowpassState;
+        float* outLeft = targets[0];
+        float* outRight = targets[1];
+        for (int n = 0; n < blockSize; n++) {
+            y += a * (in[n] - y);
+            gainLeft += stepLeft;
+            gainRight += stepRight;
+            outLeft[n] += gainLeft * y;
+            outRight[n] += gainRight * y;
+        }
+        voice.gainLeft = left;
+        voice.gainRight = right;
+        // keep the decaying state out of the denormal range
+        voice.lowpassState = std::fabs(y) < 1e-20f ? 0.0f : y;
+    }
+
+    /** Adds a voice's early reflection taps to targets, crossfading with
+     *  the convolution when the filters changed this block.
+     */
+    void renderTaps(Voice& voice, const float* in, const FilterSet* previous, float* const* targets) {
+        if (earlyLength <= 0) {
+            return;
+        }
+        voice.early.pushInput(in);
+        if (!voice.current) {
+            return;
+        }
+        for (int ch = 0; ch < kChannels; ch++) {
+            if (previous) {
+                voice.early.crossfade(previous->taps[ch], voice.current->taps[ch], targets[ch]);
+            } else {
+                voice.early.process(voice.current->taps[ch], targets[ch]);
+            }
+        }
+    }
+
+    static void accumulate(float* const* outputs, float* const* targets, int blockSize) {
+        for (int ch = 0; ch < kChannels; ch++) {
+            float* dst = targets[ch];
+            const float* src = outputs[ch];
+            for (int n = 0; n < blockSize; n++) {
+                dst[n] += src[n];
+            }
+        }
+    }
+
+    void accumulate(float* const* outputs, float* const* targets) {
+        accumulate(outputs, targets, blockSize);
+    }
+
+    static int64_t elapsedNanos(std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - since).count();
+    }
+
+    nvar_t nvar;
+    std::atomic<int> mixMode;
+    int blockSize;
+    int sampleRate;
+    int filterLength;
+    float earlyWindow;
+    int earlyLength;
+    int inputCapacity;
+    bool running;
+    std::atomic<bool> stopping;
+    std::atomic<int> underruns;
+    std::atomic<int64_t> renderedFrames;
+    std::thread thread;
+
+    Voice voices[kMaxVoices];
+    std::atomic<int> voiceCount;
+    std::unordered_map<nvarSource_t, int> voiceBySource;   // main thread only
+    std::vector<std::pair<nvarSource_t, int> > detached;     // voice of each detached source, -1 once stopped; main thread only
+
+    dsp::RingBuffer output;
+    dsp::AlignedBuffer scratch[kChannels];
+    dsp::AlignedBuffer mix[kChannels];
+    dsp::AlignedBuffer fadeFrom[kChannels];   // a voice switching its level of detail
+    dsp::AlignedBuffer fadeTo[kChannels];
+    dsp::AlignedBuffer interleaved;
+
+    std::atomic<int64_t> lodNanos[LOD_COUNT];    // audio thread and tail worker to main thread
+    std::atomic<int64_t> lodBlocks[LOD_COUNT];
+
+    FilterBuilder builder;
+    std::mutex publishLock;                     // builder and main thread, never the audio thread
+    dsp::BasicRingBuffer<FilterSet*> retired;   // audio thread to main thread
+    FilterSet silence;                          // empty spectra, faded from when the first filters arrive
+
+    // non-uniform convolver mode
+    std::thread tailThread;
+    std::condition_variable tailWake;
+    int tailPhase;                       // audio thread only
+    std::atomic<uint64_t> tailPosted;    // tail periods handed to the worker
+    std::atomic<uint64_t> tailDone;      // tail periods the worker has finished
+};
+
+#endif // GODOTNVAR_AUDIO_RENDERER_H
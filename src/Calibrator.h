@@ -0,0 +1,182 @@
+#ifndef GODOTNVAR_CALIBRATOR_H
+#define GODOTNVAR_CALIBRATOR_H
+
+#include "nvar.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+/** Outcome of a Calibrator run **/
+struct CalibrationResult {
+    nvarPreset_t preset;
+    float reverbLength;        // seconds
+    float traceMilliseconds;   // median trace time of the chosen setting
+    bool fits;                 // false if even the cheapest setting missed the target
+};
+
+/** Finds the best compute preset and reverb length whose traces finish
+ *  within a target time on a device. A synthetic room with pillars and a
+ *  handful of sources is traced in a temporary unnamed context, so the
+ *  named context of the game can exist at the same time. Presets are tried
+ *  from the highest quality down; the first preset whose shortest reverb
+ *  fits the target wins, with the longest reverb length that still fits.
+ */
+class Calibrator {
+public:
+    /** Reverb lengths tried for each preset, shortest first, in seconds **/
+    static const int kReverbLengths = 4;
+    /** Traces timed per setting, after one untimed warm-up trace **/
+    static const int kTraces = 3;
+    static const int kSources = 8;
+
+    static float reverbLength(int index) {
+        static const float lengths[kReverbLengths] = { 0.5f, 1.0f, 1.5f, 2.0f };
+        return lengths[index];
+    }
+
+    /** Presets in order of quality, best first **/
+    static nvarPreset_t preset(int index) {
+        static const nvarPreset_t presets[3] = { NVAR_COMPUTE_PRO, NVAR_COMPUTE_HIGH, NVAR_COMPUTE_LOW };
+        return presets[index];
+    }
+
+    static nvarStatus_t run(int device, float targetMilliseconds, CalibrationResult& result) {
+        nvarStatus_t nvarStatus = NVAR_STATUS_SUCCESS;
+        result.preset = NVAR_COMPUTE_LOW;
+        result.reverbLength = reverbLength(0);
+        result.traceMilliseconds = 0.0f;
+        result.fits = false;
+
+        for (int p = 0; p < 3; p++) {
+            nvar_t nvar;
+            int deviceNum = device;
+            nvarStatus = nvarCreate(&nvar, NULL, 0, preset(p), &deviceNum);
+            if (nvarStatus != NVAR_STATUS_SUCCESS) {
+                return nvarStatus;
+            }
+            nvarStatus = buildScene(nvar);
+            // longer reverbs only cost more, so stop at the first that misses
+            for (int r = 0; r < kReverbLengths && nvarStatus == NVAR_STATUS_SUCCESS; r++) {
+                float milliseconds = 0.0f;
+                nvarStatus = measure(nvar, reverbLength(r), milliseconds);
+                if (nvarStatus != NVAR_STATUS_SUCCESS) {
+                    break;
+                }
+                if (milliseconds > targetMilliseconds) {
+                    if (r == 0) {
+                        // the cheapest setting tried so far is the answer if nothing fits
+                        result.preset = preset(p);
+                        result.traceMilliseconds = milliseconds;
+                    }
+                    break;
+                }
+                result.preset = preset(p);
+                result.reverbLength = reverbLength(r);
+                result.traceMilliseconds = milliseconds;
+                result.fits = true;
+            }
+            nvarDestroy(nvar);
+            if (nvarStatus != NVAR_STATUS_SUCCESS || result.fits) {
+                return nvarStatus;
+            }
+        }
+        return nvarStatus;
+    }
+
+private:
+    /** A 12 x 4 x 10 meter concrete room with four pillars, in NVAR units **/
+    static nvarStatus_t buildScene(nvar_t nvar) {
+        nvarStatus_t nvarStatus;
+        nvarMaterial_t material;
+        float unit = 1.0f;
+
+        nvarGetUnitLength(nvar, &unit);
+        nvarStatus = nvarCreatePredefinedMaterial(nvar, &material, NVAR_PREDEFINED_MATERIAL_CONCRETE);
+        if (nvarStatus != NVAR_STATUS_SUCCESS) {
+            return nvarStatus;
+        }
+        std::vector<nvarFloat3_t> vertices;
+        std::vector<int> faces;
+        addBox(vertices, faces, -6.0f, 0.0f, -5.0f, 6.0f, 4.0f, 5.0f, unit);
+        for (int i = 0; i < 4; i++) {
+            float x = (i % 2 ? 2.5f : -2.5f);
+            float z = (i / 2 ? 2.0f : -2.0f);
+            addBox(vertices, faces, x - 0.4f, 0.0f, z - 0.4f, x + 0.4f, 4.0f, z + 0.4f, unit);
+        }
+
+        nvarMatrix4x4_t identity = { { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 } };
+        nvarMesh_t mesh;
+        nvarStatus = nvarCreateMesh(nvar, &mesh, identity, vertices.data(), (int)vertices.size(),
+                                    faces.data(), (int)faces.size() / 3, material);
+        if (nvarStatus != NVAR_STATUS_SUCCESS) {
+            return nvarStatus;
+        }
+        nvarFloat3_t listener = { 0.0f, 1.7f * unit, 0.0f };
+        nvarSetListenerLocation(nvar, listener);
+        return nvarCommitGeometry(nvar);
+    }
+
+    static void addBox(std::vector<nvarFloat3_t>& vertices, std::vector<int>& faces,
+                       float x0, float y0, float z0, float x1, float y1, float z1, float unit) {
+        static const int quads[6][4] = {
+            { 0, 1, 3, 2 }, { 4, 6, 7, 5 }, { 0, 4, 5, 1 }, { 2, 3, 7, 6 }, { 0, 2, 6, 4 }, { 1, 5, 7, 3 },
+        };
+        int base = (int)vertices.size();
+        for (int i = 0; i < 8; i++) {
+            nvarFloat3_t vertex = { (i & 4 ? x1 : x0) * unit, (i & 2 ? y1 : y0) * unit, (i & 1 ? z1 : z0) * unit };
+            vertices.push_back(vertex);
+        }
+        for (int q = 0; q < 6; q++) {
+            int triangles[6] = { quads[q][0], quads[q][1], quads[q][2], quads[q][0], quads[q][2], quads[q][3] };
+            for (int k = 0; k < 6; k++) {
+                faces.push_back(base + triangles[k]);
+            }
+        }
+    }
+
+    /** Median time of kTraces traces with kSources sources at one reverb length **/
+    static nvarStatus_t measure(nvar_t nvar, float reverbLength, float& milliseconds) {
+        nvarStatus_t nvarStatus;
+        nvarSource_t sources[kSources];
+        int created = 0;
+        float unit = 1.0f;
+
+        nvarGetUnitLength(nvar, &unit);
+        // set before any source exists, which is how a game would use it
+        nvarStatus = nvarSetReverbLength(nvar, reverbLength);
+        for (; created < kSources && nvarStatus == NVAR_STATUS_SUCCESS; created++) {
+            nvarStatus = nvarCreateSource(nvar, NVAR_EFFECT_PRESET_DEFAULT, &sources[created]);
+            if (nvarStatus != NVAR_STATUS_SUCCESS) {
+                break;
+            }
+            float angle = created * 6.2831853f / kSources;
+            nvarFloat3_t location = { 4.5f * std::cos(angle) * unit, 1.5f * unit, 3.5f * std::sin(angle) * unit };
+            nvarSetSourceLocation(sources[created], location);
+        }
+
+        std::vector<float> times;
+        for (int t = 0; t <= kTraces && nvarStatus == NVAR_STATUS_SUCCESS; t++) {
+            std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+            nvarStatus = nvarTraceAudio(nvar, NULL);
+            if (nvarStatus == NVAR_STATUS_SUCCESS) {
+                nvarStatus = nvarSynchronize(nvar);
+            }
+            std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - started;
+            if (t > 0) {
+                times.push_back(elapsed.count());
+            }
+        }
+        for (int i = 0; i < created; i++) {
+            nvarDestroySource(sources[i]);
+        }
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            std::sort(times.begin(), times.end());
+            milliseconds = times[times.size() / 2];
+        }
+        return nvarStatus;
+    }
+};
+
+#endif // GODOTNVAR_CALIBRATOR_H
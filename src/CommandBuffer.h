@@ -0,0 +1,91 @@
+#ifndef GODOTNVAR_COMMAND_BUFFER_H
+#define GODOTNVAR_COMMAND_BUFFER_H
+
+#include <cstdint>
+#include <cstring>
+#include "nvar.h"
+
+/** Opcodes of the packed command stream accepted by submit_commands. Each
+ *  command is a one byte opcode followed by its arguments, little endian,
+ *  without padding. Ids are 64 bit integers, scalars are 32 bit floats and
+ *  vectors are three floats. Keep in sync with gdscript/NVARCommandBuffer.gd.
+ */
+enum CommandOp {
+    COMMAND_SET_LISTENER_LOCATION = 1,      // vec3 location
+    COMMAND_SET_LISTENER_ORIENTATION = 2,   // vec3 forward, vec3 up
+    COMMAND_SET_SOURCE_LOCATION = 3,        // id source, vec3 location
+    COMMAND_SET_SOURCE_DIRECT_GAIN = 4,     // id source, float gain
+    COMMAND_SET_SOURCE_INDIRECT_GAIN = 5,   // id source, float gain
+    COMMAND_SET_MESH_TRANSFORM = 6,         // id mesh, vec3 basis x3 (rows), vec3 origin
+    COMMAND_SET_MATERIAL_REFLECTION = 7,    // id material, float reflection
+    COMMAND_SET_MATERIAL_TRANSMISSION = 8,  // id material, float transmission
+    COMMAND_COMMIT_GEOMETRY = 9,            // no arguments
+    COMMAND_TRACE = 10,                     // no arguments
+};
+
+/** Reads typed values out of a command stream in place. Every read checks
+ *  the remaining length, so a truncated stream fails instead of overrunning.
+ */
+class CommandReader {
+public:
+    CommandReader(const uint8_t* data, int size) : cursor(data), end(data + size) { }
+
+    bool atEnd() const { return cursor >= end; }
+
+    bool readOp(uint8_t& op) {
+        if (cursor + 1 > end) {
+            return false;
+        }
+        op = *cursor++;
+        return true;
+    }
+
+    bool readID(int64_t& id) {
+        return readRaw(&id, sizeof(int64_t));
+    }
+
+    bool readFloat(float& value) {
+        return readRaw(&value, sizeof(float));
+    }
+
+    bool readFloat3(nvarFloat3_t& value) {
+        return readRaw(&value, sizeof(nvarFloat3_t));
+    }
+
+    /** Reads a Godot style transform, basis rows followed by origin, into
+     *  NVAR's row-major matrix.
+     */
+    bool readTransform(nvarMatrix4x4_t& transform) {
+        float values[12];
+        if (!readRaw(values, sizeof(values))) {
+            return false;
+        }
+        for (int row = 0; row < 3; row++) {
+            transform.a[row * 4 + 0] = values[row * 3 + 0];
+            transform.a[row * 4 + 1] = values[row * 3 + 1];
+            transform.a[row * 4 + 2] = values[row * 3 + 2];
+            transform.a[row * 4 + 3] = values[9 + row];
+        }
+        transform.a[12] = 0.0f;
+        transform.a[13] = 0.0f;
+        transform.a[14] = 0.0f;
+        transform.a[15] = 1.0f;
+        return true;
+    }
+
+private:
+    // the stream is little endian, like every platform Godot ships on
+    bool readRaw(void* out, size_t size) {
+        if ((size_t)(end - cursor) < size) {
+            return false;
+        }
+        std::memcpy(out, cursor, size);
+        cursor += size;
+        return true;
+    }
+
+    const uint8_t* cursor;
+    const uint8_t* end;
+};
+
+#endif // GODOTNVAR_COMMAND_BUFFER_H
@@ -0,0 +1,120 @@
+#ifndef GODOTNVAR_CONTEXT_WARMUP_H
+#define GODOTNVAR_CONTEXT_WARMUP_H
+
+#include "nvar.h"
+
+#include <vector>
+
+/** Everything needed to bring up a context, as plain values so it can be
+ *  handed to a worker thread. Negative values keep NVAR's defaults.
+ */
+struct ContextSetup {
+    int flags;                   // passed to nvarInitialize, negative if the API is already initialized
+    nvarPreset_t preset;
+    int device;
+    int outputFormat;
+    int sampleRate;
+    float reverbLength;
+    float decayFactor;
+    float unitLength;
+
+    ContextSetup() : flags(-1), preset(NVAR_COMPUTE_PRESET_DEFAULT), device(0), outputFormat(-1), sampleRate(-1),
+                     reverbLength(-1.0f), decayFactor(-1.0f), unitLength(-1.0f) { }
+};
+
+/** Initializes NVAR, creates and configures a context, and warms it up so
+ *  the first real trace does not pay for lazy device setup: a throwaway
+ *  source is traced once and its filters applied to a block of silence.
+ *  Everything here blocks, so it is meant for a worker thread.
+ */
+class ContextWarmup {
+public:
+    /** Samples in the silent block the warm-up filters **/
+    static const int kWarmupSamples = 512;
+
+    /** Creates the context in nvar. setup.device is updated to the device NVAR picked. **/
+    static nvarStatus_t run(ContextSetup& setup, const char* name, size_t nameLength, nvar_t& nvar) {
+        nvarStatus_t nvarStatus = NVAR_STATUS_SUCCESS;
+
+        if (setup.flags >= 0) {
+            nvarStatus = nvarInitialize(setup.flags);
+            if (nvarStatus != NVAR_STATUS_SUCCESS) {
+                return nvarStatus;
+            }
+        }
+        nvarStatus = nvarCreate(&nvar, name, nameLength, setup.preset, &setup.device);
+        if (nvarStatus != NVAR_STATUS_SUCCESS) {
+            return nvarStatus;
+        }
+        nvarStatus = configure(setup, nvar);
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            nvarStatus = warmUp(nvar);
+        }
+        if (nvarStatus != NVAR_STATUS_SUCCESS) {
+            nvarDestroy(nvar);
+        }
+        return nvarStatus;
+    }
+
+private:
+    /** Reallocating settings first, in the order configure applies them **/
+    static nvarStatus_t configure(const ContextSetup& setup, nvar_t nvar) {
+        nvarStatus_t nvarStatus = NVAR_STATUS_SUCCESS;
+        if (setup.outputFormat >= 0) {
+            nvarStatus = nvarSetOutputFormat(nvar, static_cast<nvarOutputFormat_t>(setup.outputFormat));
+        }
+        if (nvarStatus == NVAR_STATUS_SUCCESS && setup.sampleRate > 0) {
+            nvarStatus = nvarSetSampleRate(nvar, setup.sampleRate);
+        }
+        if (nvarStatus == NVAR_STATUS_SUCCESS && setup.reverbLength > 0.0f) {
+            nvarStatus = nvarSetReverbLength(nvar, setup.reverbLength);
+        }
+        if (nvarStatus == NVAR_STATUS_SUCCESS && setup.decayFactor > 0.0f) {
+            nvarStatus = nvarSetDecayFactor(nvar, setup.decayFactor);
+        }
+        if (nvarStatus == NVAR_STATUS_SUCCESS && setup.unitLength > 0.0f) {
+            nvarStatus = nvarSetUnitLength(nvar, setup.unitLength);
+        }
+        return nvarStatus;
+    }
+
+    /** Traces one source in the empty scene and filters silence with it **/
+    static nvarStatus_t warmUp(nvar_t nvar) {
+        nvarStatus_t nvarStatus;
+        nvarSource_t source;
+        float unit = 1.0f;
+        int channels = 2;
+        nvarOutputFormat_t outputFormat = NVAR_DEFAULT_OUTPUT_FORMAT;
+
+        nvarGetUnitLength(nvar, &unit);
+        nvarStatus = nvarCreateSource(nvar, NVAR_EFFECT_PRESET_DEFAULT, &source);
+        if (nvarStatus != NVAR_STATUS_SUCCESS) {
+            return nvarStatus;
+        }
+        nvarFloat3_t location = { 0.0f, 0.0f, -unit };
+        nvarSetSourceLocation(source, location);
+
+        nvarStatus = nvarCommitGeometry(nvar);
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            nvarStatus = nvarTraceAudio(nvar, NULL);
+        }
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            nvarStatus = nvarSynchronize(nvar);
+        }
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            nvarGetOutputFormat(nvar, &outputFormat);
+            nvarGetOutputFormatChannels(outputFormat, &channels);
+            std::vector<float> input(kWarmupSamples, 0.0f);
+            std::vector<std::vector<float> > output(channels, std::vector<float>(kWarmupSamples));
+            std::vector<float*> outputs(channels);
+            for (int ch = 0; ch < channels; ch++) {
+                outputs[ch] = output[ch].data();
+            }
+            nvarStatus = nvarApplySourceFilters(source, outputs.data(), input.data(), kWarmupSamples);
+        }
+        nvarDestroySource(source);
+        return nvarStatus;
+    }
+};
+
+#endif // GODOTNVAR_CONTEXT_WARMUP_H
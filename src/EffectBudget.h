@@ -0,0 +1,132 @@
+#ifndef GODOTNVAR_EFFECT_BUDGET_H
+#define GODOTNVAR_EFFECT_BUDGET_H
+
+#include "nvar.h"
+#include "HandleTable.h"
+#include "VoiceBudget.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/** Lowers the effect preset of less important sources so traces finish
+ *  within a time budget. A trace is modeled as costing a fixed time per unit
+ *  of effect weight, where each preset step doubles the weight as it doubles
+ *  the rays traced. The unit time is learned from the measured duration of
+ *  traces issued after the presets last changed. Sources are then visited
+ *  in order of their VoiceBudget score and each gets the highest preset, up
+ *  to the one it was created with, that the remaining budget pays for.
+ */
+class EffectBudget {
+public:
+    EffectBudget() : budget(0.0f), upgradeMargin(1.2f), traceMilliseconds(0.0), unitMilliseconds(0.0),
+                     weight(0.0), measuredFrom(0), fresh(false) { }
+
+    /** Milliseconds a trace may take. 0 disables the budget and every
+     *  source traces with its own preset.
+     */
+    void setBudget(float milliseconds) {
+        budget = std::max(milliseconds, 0.0f);
+        fresh = true;
+    }
+    float getBudget() const { return budget; }
+
+    /** Smoothed duration of recent traces, 0 until one completed **/
+    double getTraceMilliseconds() const { return traceMilliseconds; }
+
+    static float effectWeight(int effect) { return (float)(1 << effect); }
+
+    /** Records how long a trace took. Traces issued before the presets last
+     *  changed only update the trace time, not the cost model.
+     */
+    void observe(uint64_t traceNumber, double milliseconds) {
+        traceMilliseconds = traceMilliseconds > 0.0 ? traceMilliseconds + kSmoothing * (milliseconds - traceMilliseconds)
+                                                    : milliseconds;
+        if (traceNumber < measuredFrom || weight <= 0.0) {
+            return;
+        }
+        double unit = milliseconds / weight;
+        unitMilliseconds = unitMilliseconds > 0.0 ? unitMilliseconds + kSmoothing * (unit - unitMilliseconds) : unit;
+        fresh = true;
+    }
+
+    /** Asks the next plan to run even without a new measurement **/
+    void invalidate() { fresh = true; }
+
+    /** Sets appliedEffect for every live source, once per new measurement.
+     *  nextTrace is the number the next trace will get; measurements of
+     *  earlier traces no longer describe the live sources and their presets.
+     *  Returns true if any preset changed.
+     */
+    bool plan(HandleTable<SourceState>& sources, uint64_t nextTrace) {
+        ranked.clear();
+        for (int i = 0; i < sources.size(); i++) {
+            if (sources.at(i).isLive()) {
+                ranked.push_back(i);
+            }
+        }
+        bool changed = false;
+        if (fresh) {
+            fresh = false;
+            changed = assign(sources);
+        }
+
+        double total = 0.0;
+        for (size_t i = 0; i < ranked.size(); i++) {
+            total += effectWeight(sources.at(ranked[i]).appliedEffect);
+        }
+        if (total != weight) {
+            measuredFrom = nextTrace;
+            weight = total;
+        }
+        return changed;
+    }
+
+private:
+    bool assign(HandleTable<SourceState>& sources) {
+        bool changed = false;
+        if (budget <= 0.0f || unitMilliseconds <= 0.0) {
+            for (size_t i = 0; i < ranked.size(); i++) {
+                SourceState& state = sources.at(ranked[i]);
+                changed |= state.appliedEffect != state.effect;
+                state.appliedEffect = state.effect;
+            }
+            return changed;
+        }
+
+        std::sort(ranked.begin(), ranked.end(), [&sources](int a, int b) {
+            return sources.at(a).score > sources.at(b).score;
+        });
+        // every source traces at least at NVAR_EFFECT_LOW, the rest is spent on upgrades
+        float low = effectWeight(NVAR_EFFECT_LOW);
+        double remaining = budget / unitMilliseconds - ranked.size() * low;
+        for (size_t i = 0; i < ranked.size(); i++) {
+            SourceState& state = sources.at(ranked[i]);
+            int effect = state.effect;
+            for (; effect > NVAR_EFFECT_LOW; effect--) {
+                double needed = (effectWeight(effect) - low) * (effect > state.appliedEffect ? upgradeMargin : 1.0f);
+                if (needed <= remaining) {
+                    break;
+                }
+            }
+            changed |= state.appliedEffect != effect;
+            state.appliedEffect = (nvarEffect_t)effect;
+            remaining -= effectWeight(effect) - low;
+        }
+        return changed;
+    }
+
+    /** Weight of each new measurement in the running averages **/
+    static constexpr double kSmoothing = 0.25;
+
+    float budget;
+    float upgradeMargin;
+    double traceMilliseconds;
+    double unitMilliseconds;   // trace time per unit of effect weight
+    double weight;             // effect weight of the live sources as last planned
+    uint64_t measuredFrom;     // first trace that ran with the current presets
+    bool fresh;                // something new to plan with since the last plan
+    std::vector<int> ranked;
+};
+
+#endif // GODOTNVAR_EFFECT_BUDGET_H
@@ -0,0 +1,196 @@
+#ifndef GODOTNVAR_FILTER_BUILDER_H
+#define GODOTNVAR_FILTER_BUILDER_H
+
+#include "dsp/EnergyDecay.h"
+#include "dsp/FFT.h"
+#include "dsp/PartitionedConvolver.h"
+#include "dsp/TapDelay.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** Partitioned spectra of one source's stereo filters from one trace. For
+ *  non-uniform convolution, spectrum covers the first tailOffset taps and
+ *  tail the rest, in longer partitions; otherwise tailOffset is 0.
+ *  length is the per-channel length after energy truncation, fullLength
+ *  the length NVAR returned. A sparse start of each filter may be moved
+ *  into taps for a dsp::MultiTapDelay, in which case the spectra see zeros
+ *  there.
+ */
+struct FilterSet {
+    static const int kChannels = 2;
+
+    int length;
+    int fullLength;
+    int tailOffset;
+    dsp::FilterSpectrum spectrum[kChannels];
+    dsp::FilterSpectrum tail[kChannels];
+    dsp::TapSet taps[kChannels];
+};
+
+/** Transforms filter arrays fetched with nvarGetSourceFilters into
+ *  FilterSets on a background thread, so neither the main thread nor the
+ *  audio thread pays for the forward FFTs. Only the newest job per voice is
+ *  kept; finished sets are handed to the publish callback on the builder
+ *  thread, which takes ownership of them.
+ */
+class FilterBuilder {
+public:
+    typedef std::function<void(int voice, uint32_t generation, FilterSet* filters)> PublishCallback;
+
+    /** At most this many early reflection taps per channel **/
+    static const int kMaxTaps = 64;
+    /** A tap costs about half of a partition's complex multiply-accumulate **/
+    static const int kTapsPerPartition = 2;
+
+    FilterBuilder() : partitionSize(0), tailPartitionSize(0), earlyLength(0), truncationFloor(-60.0f), stopping(false) { }
+
+    ~FilterBuilder() {
+        stop();
+    }
+
+    /** tailPartitionSize is the tail partition of a dsp::NonUniformConvolver,
+     *  or 0 to build uniform spectra only. Sparse taps are looked for in the
+     *  first earlyLength samples of each filter; 0 disables the search.
+     */
+    void start(int partitionSize, int tailPartitionSize, int earlyLength, const PublishCallback& callback) {
+        stop();
+        this->partitionSize = partitionSize;
+        this->tailPartitionSize = tailPartitionSize;
+        this->earlyLength = earlyLength;
+        publish = callback;
+        stopping = false;
+        worker = std::thread(&FilterBuilder::buildLoop, this);
+    }
+
+    void stop() {
+        if (!worker.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+            jobs.clear();
+        }
+        wake.notify_all();
+        worker.join();
+    }
+
+    bool isRunning() const { return worker.joinable(); }
+
+    /** Filters are cut where the energy left in the rest of the response
+     *  drops this many dB below the total, so sources in dead rooms convolve
+     *  only their actual decay. 0 keeps the full length. Applies to builds
+     *  that start after the call.
+     */
+    void setTruncationFloor(float floorDb) { truncationFloor.store(std::min(floorDb, 0.0f)); }
+    float getTruncationFloor() const { return truncationFloor.load(); }
+
+    /** Queues a filter array laid out as nvarGetSourceFilters returns it.
+     *  Replaces any job for the same voice that has not started yet.
+     */
+    void submit(int voice, uint32_t generation, std::vector<float>& filterArray, int perChannel) {
+        std::lock_guard<std::mutex> guard(lock);
+        Job* job = nullptr;
+        for (size_t i = 0; i < jobs.size(); i++) {
+            if (jobs[i].voice == voice) {
+                job = &jobs[i];
+                break;
+            }
+        }
+        if (!job) {
+            jobs.push_back(Job());
+            job = &jobs.back();
+            job->voice = voice;
+        }
+        job->generation = generation;
+        job->perChannel = perChannel;
+        job->filters.swap(filterArray);
+        wake.notify_one();
+    }
+
+private:
+    struct Job {
+        int voice;
+        uint32_t generation;
+        int perChannel;
+        std::vector<float> filters;
+    };
+
+    void buildLoop() {
+        dsp::RealFFT fft;
+        dsp::RealFFT tailFFT;
+        fft.init(2 * partitionSize);
+        if (tailPartitionSize > 0) {
+            tailFFT.init(2 * tailPartitionSize);
+        }
+        std::unique_lock<std::mutex> guard(lock);
+        for (;;) {
+            wake.wait(guard, [this] { return stopping || !jobs.empty(); });
+            if (stopping) {
+                break;
+            }
+            Job job;
+            job.filters.swap(jobs.front().filters);
+            job.voice = jobs.front().voice;
+            job.generation = jobs.front().generation;
+            job.perChannel = jobs.front().perChannel;
+            jobs.pop_front();
+            guard.unlock();
+
+            FilterSet* filters = new FilterSet();
+            filters->fullLength = job.perChannel;
+            filters->length = dsp::energyDecayLength(job.filters.data(), FilterSet::kChannels, job.perChannel,
+                                                     truncationFloor.load());
+            filters->tailOffset = tailPartitionSize > 0 ? 2 * tailPartitionSize : 0;
+            int headLength = filters->tailOffset > 0 ? std::min(filters->length, filters->tailOffset) : filters->length;
+            float tapFloor = earlyLength > 0 ? peak(job.filters) * kTapFloor : 0.0f;
+            for (int ch = 0; ch < FilterSet::kChannels; ch++) {
+                float* filter = &job.filters[(size_t)job.perChannel * ch];
+                if (earlyLength > 0) {
+                    filters->taps[ch].extract(filter, headLength, partitionSize, earlyLength,
+                                              tapFloor, kMaxTaps, kTapsPerPartition);
+                }
+                filters->spectrum[ch].build(fft, filter, headLength, partitionSize);
+                if (filters->tailOffset > 0) {
+                    filters->tail[ch].build(tailFFT, filter + headLength, filters->length - headLength, tailPartitionSize);
+                }
+            }
+            publish(job.voice, job.generation, filters);
+
+            guard.lock();
+        }
+    }
+
+    /** Early samples this far below the filter's peak (-100 dB) count as silence **/
+    static constexpr float kTapFloor = 1e-5f;
+
+    static float peak(const std::vector<float>& filters) {
+        float value = 0.0f;
+        for (size_t i = 0; i < filters.size(); i++) {
+            value = std::max(value, std::fabs(filters[i]));
+        }
+        return value;
+    }
+
+    int partitionSize;
+    int tailPartitionSize;
+    int earlyLength;
+    std::atomic<float> truncationFloor;
+    PublishCallback publish;
+    std::thread worker;
+    std::mutex lock;
+    std::condition_variable wake;
+    bool stopping;
+    std::deque<Job> jobs;
+};
+
+#endif // GODOTNVAR_FILTER_BUILDER_H
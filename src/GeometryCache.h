@@ -0,0 +1,90 @@
+#ifndef GODOTNVAR_GEOMETRY_CACHE_H
+#define GODOTNVAR_GEOMETRY_CACHE_H
+
+#include "SceneState.h"
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+/** Converted geometry of Godot Mesh resources, so a Mesh placed many times
+ *  is only converted once. Entries are keyed by the Mesh's RID and a
+ *  version that invalidate bumps when the Mesh changes. The cache only
+ *  holds weak references: the geometry is freed with the last acoustic
+ *  mesh using it, and its entry is dropped lazily.
+ */
+class GeometryCache {
+public:
+    GeometryCache() : hits(0), misses(0), pruneAt(kMinPrune) { }
+
+    /** Finds the geometry of the current version of a Mesh **/
+    bool find(int64_t key, std::shared_ptr<const MeshGeometry>& geometry) {
+        std::unordered_map<int64_t, Entry>::iterator it = entries.find(key);
+        if (it == entries.end() || it->second.version != it->second.cachedVersion ||
+            !(geometry = it->second.geometry.lock())) {
+            misses++;
+            return false;
+        }
+        hits++;
+        return true;
+    }
+
+    /** Remembers the geometry converted from the current version of a Mesh **/
+    void store(int64_t key, const std::shared_ptr<const MeshGeometry>& geometry) {
+        Entry& entry = entries[key];
+        entry.geometry = geometry;
+        entry.cachedVersion = entry.version;
+        if (entries.size() >= pruneAt) {
+            prune();
+        }
+    }
+
+    /** Marks the cached geometry of a Mesh as stale. Meshes created from it keep it. **/
+    void invalidate(int64_t key) {
+        std::unordered_map<int64_t, Entry>::iterator it = entries.find(key);
+        if (it != entries.end()) {
+            it->second.version++;
+            it->second.geometry.reset();
+        }
+    }
+
+    void clear() {
+        entries.clear();
+        pruneAt = kMinPrune;
+    }
+
+    int getHits() const { return hits; }
+    int getMisses() const { return misses; }
+    int size() const { return (int)entries.size(); }
+
+private:
+    struct Entry {
+        std::weak_ptr<const MeshGeometry> geometry;
+        uint64_t version;        // bumped on every change of the Mesh
+        uint64_t cachedVersion;  // version the geometry was converted from
+
+        Entry() : version(0), cachedVersion(0) { }
+    };
+
+    static const size_t kMinPrune = 64;
+
+    /** Drops entries whose geometry is no longer used by any mesh **/
+    void prune() {
+        for (std::unordered_map<int64_t, Entry>::iterator it = entries.begin(); it != entries.end();) {
+            if (it->second.geometry.expired()) {
+                it = entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        // prune again once the cache has doubled, so pruning stays amortized O(1)
+        pruneAt = entries.size() * 2 > kMinPrune ? entries.size() * 2 : kMinPrune;
+    }
+
+    std::unordered_map<int64_t, Entry> entries;
+    int hits;
+    int misses;
+    size_t pruneAt;
+};
+
+#endif // GODOTNVAR_GEOMETRY_CACHE_H
@@ -1,8 +1,30 @@
 #include <Godot.hpp>
 #include <Reference.hpp>
 #include "nvar.h"
+#include <cmath>
+#include <cstring>
 #include <map>
+#include <thread>
 #include <Mesh.hpp>
+#include <GridMap.hpp>
+#include <MultiMeshInstance.hpp>
+#include "MeshBuilder.h"
+#include "HandleTable.h"
+#include "CommandBuffer.h"
+#include "TraceScheduler.h"
+#include "AudioRenderer.h"
+#include "Calibrator.h"
+#include "ContextWarmup.h"
+#include "EffectBudget.h"
+#include "GeometryCache.h"
+#include "LodPlanner.h"
+#include "SceneState.h"
+#include "TransformBatch.h"
+#include "VoiceBudget.h"
+#include <AudioStreamGeneratorPlayback.hpp>
+#include <ConfigFile.hpp>
+#include <Engine.hpp>
+#include <SceneTree.hpp>
 
 using namespace godot;
 
@@ -11,6 +33,23 @@ class GodotNVAR : public Reference {
 public:
     GodotNVAR() { }
 
+    ~GodotNVAR() {
+        // the completion thread must not outlive the object it reports to;
+        // queued traces signal their events before the scheduler lets go of them
+        audioRenderer.stop();
+        if (contextCreated) {
+            nvarSynchronize(nvar);
+        }
+        traceScheduler.stop();
+        if (createThread.joinable()) {
+            createThread.join();
+            if (asyncStatus == NVAR_STATUS_SUCCESS) {
+                // nobody is left to adopt the context
+                nvarDestroy(asyncNvar);
+            }
+        }
+    }
+
     /** `_init` must exist as it is called by Godot. */
     void _init() { }
 
@@ -152,26 +191,365 @@ public:
     /** Creates and inits an NVAR processing context **/
     void create(int preset, int device = 0) {
         nvarStatus_t nvarStatus;
+        if (creatingAsync) { // create_async has not finished yet.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return;
+        }
 
-        nvarStatus = nvarCreate(&nvar, contextName, sizeof(contextName), 
+        nvarStatus = nvarCreate(&nvar, contextName, std::strlen(contextName),
             static_cast<nvarPreset_t>(preset), &device);
         if (nvarStatus == NVAR_STATUS_SUCCESS) {
-            // Success
+            contextCreated = true;
+            contextPreset = preset;
+            contextDevice = device;
+            contextSettings.clear();
+            listener = ListenerState();
+            startTraceScheduler();
+        } else {
+            printError(nvarStatus, __FUNCTION__, __LINE__);
+        }
+    }
+
+    /** Does what initialize, create and configure do, then traces a
+     *  throwaway source and filters a block of silence with it, all on a
+     *  worker thread so the main thread stays responsive and the first real
+     *  trace does not hitch. flags is passed to initialize, or -1 if the API
+     *  is already initialized; settings takes the keys of configure.
+     *  context_ready is emitted with the outcome once the context is usable;
+     *  until then no other method may be called. Returns false if nothing
+     *  was started.
+     */
+    bool createAsync(int flags, int preset, int device, Dictionary settings) {
+        Array keys = settings.keys();
+        for (int i = 0; i < keys.size(); i++) {
+            if (!isValidSetting(keys[i], settings[keys[i]])) {
+                printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+                return false;
+            }
+        }
+        if (creatingAsync || contextCreated) { // create_async has not finished yet, or a context exists.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return false;
+        }
+
+        // the worker only sees plain values, Variants stay on the main thread
+        asyncSetup = ContextSetup();
+        asyncSetup.flags = flags;
+        asyncSetup.preset = static_cast<nvarPreset_t>(preset);
+        asyncSetup.device = device;
+        if (settings.has("output_format")) {
+            asyncSetup.outputFormat = (int64_t)settings["output_format"];
+        }
+        if (settings.has("sample_rate")) {
+            asyncSetup.sampleRate = (int64_t)settings["sample_rate"];
+        }
+        if (settings.has("reverb_length")) {
+            asyncSetup.reverbLength = (float)settings["reverb_length"];
+        }
+        if (settings.has("decay_factor")) {
+            asyncSetup.decayFactor = (float)settings["decay_factor"];
+        }
+        if (settings.has("unit_length")) {
+            asyncSetup.unitLength = (float)settings["unit_length"];
+        }
+        asyncSettings = settings;
+        creatingAsync = true;
+        createThread = std::thread([this]() {
+            asyncStatus = ContextWarmup::run(asyncSetup, contextName, std::strlen(contextName), asyncNvar);
+            call_deferred("_on_context_ready");
+        });
+        return true;
+    }
+
+    /** Called on the main thread once create_async's worker has finished **/
+    void _on_context_ready() {
+        createThread.join();
+        creatingAsync = false;
+        if (asyncStatus == NVAR_STATUS_SUCCESS) {
+            nvar = asyncNvar;
+            contextCreated = true;
+            contextPreset = asyncSetup.preset;
+            contextDevice = asyncSetup.device;
+            contextSettings = asyncSettings;
+            listener = ListenerState();
+            startTraceScheduler();
         } else {
+            printError(asyncStatus, __FUNCTION__, __LINE__);
+        }
+        asyncSettings = Dictionary();
+        emit_signal("context_ready", asyncStatus == NVAR_STATUS_SUCCESS);
+    }
+
+    void startTraceScheduler() {
+        // completions arrive on the scheduler's thread, hand them to the main loop
+        traceScheduler.start([this](uint64_t traceNumber, double milliseconds) {
+            call_deferred("_on_trace_completed", (int64_t)traceNumber, milliseconds);
+        });
+    }
+
+    /** Finds the best compute preset and reverb length whose traces finish
+     *  within targetMilliseconds on a device, by timing a synthetic scene in
+     *  a temporary unnamed context. The result is saved per device and NVAR
+     *  version in user://, and later calls with the same target return it
+     *  without tracing unless force is set. Returns a Dictionary with
+     *  preset, reverb_length, trace_milliseconds, fits (false if even the
+     *  cheapest setting missed the target) and cached.
+     */
+    Variant calibrate(float targetMilliseconds, int device, bool force) {
+        nvarStatus_t nvarStatus;
+        int version = 0;
+        char name[32];
+        if (targetMilliseconds <= 0.0f) {
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return Variant();
+        }
+
+        nvarStatus = nvarGetVersion(&version);
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            nvarStatus = nvarGetDeviceName(device, name, 32);
+        }
+        if (nvarStatus != NVAR_STATUS_SUCCESS) {
             printError(nvarStatus, __FUNCTION__, __LINE__);
+            return Variant();
+        }
+        // a new driver or device changes the timings, so both are part of the key
+        String section = String(name) + String(" ") + String::num_int64(device);
+        Ref<ConfigFile> config = ConfigFile::_new();
+        bool loaded = config->load(kCalibrationPath) == OK;
+        if (loaded && !force && config->has_section_key(section, "preset") &&
+            (int64_t)config->get_value(section, "version") == version &&
+            std::fabs((float)config->get_value(section, "target_milliseconds") - targetMilliseconds) < 1e-3f) {
+            Dictionary result;
+            result["preset"] = config->get_value(section, "preset");
+            result["reverb_length"] = config->get_value(section, "reverb_length");
+            result["trace_milliseconds"] = config->get_value(section, "trace_milliseconds");
+            result["fits"] = config->get_value(section, "fits");
+            result["cached"] = true;
+            return Variant(result);
+        }
+
+        CalibrationResult calibration;
+        nvarStatus = Calibrator::run(device, targetMilliseconds, calibration);
+        if (nvarStatus != NVAR_STATUS_SUCCESS) {
+            printError(nvarStatus, __FUNCTION__, __LINE__);
+            return Variant();
+        }
+        config->set_value(section, "version", version);
+        config->set_value(section, "target_milliseconds", targetMilliseconds);
+        config->set_value(section, "preset", (int)calibration.preset);
+        config->set_value(section, "reverb_length", calibration.reverbLength);
+        config->set_value(section, "trace_milliseconds", calibration.traceMilliseconds);
+        config->set_value(section, "fits", calibration.fits);
+        if (config->save(kCalibrationPath) != OK) {
+            Godot::print_error("Could not save the calibration", __FUNCTION__, __FILE__, __LINE__);
+        }
+
+        Dictionary result;
+        result["preset"] = (int)calibration.preset;
+        result["reverb_length"] = calibration.reverbLength;
+        result["trace_milliseconds"] = calibration.traceMilliseconds;
+        result["fits"] = calibration.fits;
+        result["cached"] = false;
+        return Variant(result);
+    }
+
+    /** Creates the NVAR processing context with the preset and reverb length
+     *  calibrate picks for targetMilliseconds, calibrating only if no saved
+     *  result matches. Returns the calibration Dictionary.
+     */
+    Variant createCalibrated(float targetMilliseconds, int device) {
+        Variant calibration = calibrate(targetMilliseconds, device, false);
+        if (calibration.get_type() != Variant::DICTIONARY) {
+            return Variant();
         }
+        Dictionary result = calibration;
+        create((int64_t)result["preset"], device);
+        // before any source exists, where changing it is cheap
+        setReverbLength((float)result["reverb_length"]);
+        return calibration;
     }
 
-    /** Destroys an NVAR processing context **/
+    /** Destroys an NVAR processing context, along with every material, mesh
+     *  and source in it.
+     */
     void destroy() {
         nvarStatus_t nvarStatus;
 
-        nvarStatus = nvarDestroy(nvar);
+        // let queued traces signal their events before the scheduler lets go of them
+        audioRenderer.stop();
+        releaseParkedSources();
+        nvarSynchronize(nvar);
+        traceScheduler.stop();
+        tracePending = false;
+        deferredSettings.clear();
+        contextCreated = false;
+
+        // a failed rebuild has left no context to destroy
+        nvarStatus = nvar ? nvarDestroy(nvar) : NVAR_STATUS_SUCCESS;
+        nvar = NULL;
         if (nvarStatus == NVAR_STATUS_SUCCESS) {
             // Success
         } else {
             printError(nvarStatus, __FUNCTION__, __LINE__);
         }
+        clearScene();
+    }
+
+    /** Forgets the scene of a destroyed context, whose handles NVAR has freed **/
+    void clearScene() {
+        audioRenderer.takeReleased(releasedSources);
+        releasedSources.clear();
+        sources.clear();
+        meshes.clear();
+        materials.clear();
+        sourceNames.clear();
+        meshNames.clear();
+        materialNames.clear();
+        liveSources = 0;
+        geometryCache.clear();
+        geometryBatchDepth = 0;
+        batchMeshes.clear();
+        geometryDirty = false;
+        listener = ListenerState();
+    }
+
+    /** Recreates the NVAR processing context and replays the scene into it:
+     *  every material, mesh and source keeps its id and settings, the meshes
+     *  are built from their cached vertices without reading the Godot Meshes
+     *  again, the listener is restored and the geometry committed once.
+     *  Audio that was running restarts. preset and device of -1 keep the
+     *  current ones. settings takes the keys of configure and is applied to
+     *  the new context before anything is created in it, on top of the
+     *  current and deferred settings, so this is also the way to change
+     *  reallocating settings in a live scene or to recover from a lost
+     *  device. Returns false if the new context could not be created, in
+     *  which case the scene and settings are kept and rebuild can be called
+     *  again; until then there is no context and other calls fail.
+     */
+    bool rebuild(int preset, int device, Dictionary settings) {
+        nvarStatus_t nvarStatus;
+        Array keys = settings.keys();
+        for (int i = 0; i < keys.size(); i++) {
+            if (!isValidSetting(keys[i], settings[keys[i]])) {
+                printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+                return false;
+            }
+        }
+        if (!contextCreated || geometryBatchDepth > 0) { // No context has been created, or a geometry batch is open.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return false;
+        }
+        Dictionary replay;
+        mergeSettings(replay, contextSettings);
+        mergeSettings(replay, deferredSettings);
+        mergeSettings(replay, settings);
+        preset = preset < 0 ? contextPreset : preset;
+        device = device < 0 ? contextDevice : device;
+
+        // a lost device may fail these, the context goes away regardless
+        bool audioWasRunning = audioRenderer.isRunning();
+        audioRenderer.stop();
+        nvarSynchronize(nvar);
+        traceScheduler.stop();
+        tracePending = false;
+        deferredSettings.clear();
+        nvarDestroy(nvar);
+        // destroying the context released every handle in it
+        audioRenderer.takeReleased(releasedSources);
+        releasedSources.clear();
+        std::vector<int> live;
+        for (int i = 0; i < sources.size(); i++) {
+            SourceState& state = sources.at(i);
+            if (state.isLive()) {
+                live.push_back(i);
+            }
+            state.handle = NULL;
+            state.lod = AudioRenderer::LOD_FULL;
+        }
+        liveSources = 0;
+        for (int i = 0; i < meshes.size(); i++) {
+            meshes.at(i).handle = NULL;
+        }
+        for (int i = 0; i < materials.size(); i++) {
+            materials.at(i).handle = NULL;
+        }
+
+        nvarStatus = nvarCreate(&nvar, contextName, std::strlen(contextName),
+            static_cast<nvarPreset_t>(preset), &device);
+        if (nvarStatus != NVAR_STATUS_SUCCESS) {
+            // NVAR rejects the NULL context, rather than being handed the destroyed one
+            nvar = NULL;
+            deferredSettings = replay;
+            printError(nvarStatus, __FUNCTION__, __LINE__);
+            return false;
+        }
+        contextPreset = preset;
+        contextDevice = device;
+        contextSettings.clear();
+        startTraceScheduler();
+
+        // settings first, while reallocating them is cheap
+        for (int i = 0; i < kReallocatingSettings + kImmediateSettings; i++) {
+            String key = i < kReallocatingSettings ? reallocatingSetting(i) : immediateSetting(i - kReallocatingSettings);
+            if (!replay.has(key)) {
+                continue;
+            }
+            nvarStatus = applySetting(key, replay[key]);
+            if (nvarStatus != NVAR_STATUS_SUCCESS) {
+                printError(nvarStatus, __FUNCTION__, __LINE__);
+            }
+        }
+        if (listener.hasLocation) {
+            nvarSetListenerLocation(nvar, listener.location);
+        }
+        if (listener.hasOrientation) {
+            nvarSetListenerOrientation(nvar, listener.forward, listener.up);
+        }
+
+        for (int i = 0; i < materials.size(); i++) {
+            nvarStatus = restoreMaterial(materials.at(i));
+            if (nvarStatus != NVAR_STATUS_SUCCESS) {
+                printError(nvarStatus, __FUNCTION__, __LINE__);
+            }
+        }
+        for (int i = 0; i < meshes.size(); i++) {
+            MeshState& mesh = meshes.at(i);
+            MaterialState* material = materials.get(mesh.material);
+            if (!material || !material->handle) { // The mesh's material was destroyed or not restored.
+                printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+                continue;
+            }
+            nvarStatus = createMeshState(mesh, material->handle);
+            if (nvarStatus != NVAR_STATUS_SUCCESS) {
+                printError(nvarStatus, __FUNCTION__, __LINE__);
+            }
+        }
+        geometryDirty = true;
+        nvarStatus = commitDirtyGeometry();
+        if (nvarStatus != NVAR_STATUS_SUCCESS) {
+            printError(nvarStatus, __FUNCTION__, __LINE__);
+        }
+
+        for (size_t i = 0; i < live.size(); i++) {
+            nvarStatus = realizeSource(sources.at(live[i]));
+            if (nvarStatus != NVAR_STATUS_SUCCESS) {
+                printError(nvarStatus, __FUNCTION__, __LINE__);
+            }
+        }
+        // trace times of the old context say nothing about the new one
+        effectBudget.invalidate();
+        updateSourceEffects();
+        if (audioWasRunning) {
+            startAudio(audioRenderer.getBlockSize(), audioBufferLength);
+        }
+        return true;
+    }
+
+    static void mergeSettings(Dictionary& into, Dictionary from) {
+        Array keys = from.keys();
+        for (int i = 0; i < keys.size(); i++) {
+            into[keys[i]] = from[keys[i]];
+        }
     }
 
     /** Gets the CUDA device number from the NVAR processing context **/
@@ -203,14 +581,21 @@ public:
     }
 
     /** Sets the reverb length in seconds. Changing this is expensive,
-     *  for realtime this should be set before creating any sources. 
+     *  for realtime this should be set before creating any sources. It
+     *  cannot be changed while audio runs, as the convolvers are sized for
+     *  the current filter length.
      */
     void setReverbLength(float reverbLength) {
         nvarStatus_t nvarStatus;
 
+        if (audioRenderer.isRunning()) { // Audio is running.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return;
+        }
+        warnIfSessionLive("reverb_length", __FUNCTION__, __LINE__);
         nvarStatus = nvarSetReverbLength(nvar, reverbLength);
         if (nvarStatus == NVAR_STATUS_SUCCESS) {
-            // Success
+            contextSettings["reverb_length"] = reverbLength;
         } else {
             printError(nvarStatus, __FUNCTION__, __LINE__);
         }
@@ -231,14 +616,21 @@ public:
     }
 
     /** Sets the sample rate in samples per second. Changings this is expensive,
-     *  for realtime this should be set before creating any sources. 
+     *  for realtime this should be set before creating any sources. It
+     *  cannot be changed while audio runs, as the convolvers are sized for
+     *  the current filter length.
      */
     void setSampleRate(int sampleRate) {
         nvarStatus_t nvarStatus;
 
+        if (audioRenderer.isRunning()) { // Audio is running.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return;
+        }
+        warnIfSessionLive("sample_rate", __FUNCTION__, __LINE__);
         nvarStatus = nvarSetSampleRate(nvar, sampleRate);
         if (nvarStatus == NVAR_STATUS_SUCCESS) {
-            //
+            contextSettings["sample_rate"] = sampleRate;
         } else {
             printError(nvarStatus, __FUNCTION__, __LINE__);
         }
@@ -259,14 +651,21 @@ public:
     }
 
     /** Sets the output format of filters. Changings this is expensive,
-     *  for realtime this should be set before creating any sources. 
+     *  for realtime this should be set before creating any sources. It
+     *  cannot be changed while audio runs, as the convolvers are sized for
+     *  the current filter length.
      */
     void setOutputFormat(int outputFormat) {
         nvarStatus_t nvarStatus;
 
-        nvarStatus = nvarSetSampleRate(nvar, static_cast<nvarOutputFormat_t>(outputFormat));
+        if (audioRenderer.isRunning()) { // Audio is running.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return;
+        }
+        warnIfSessionLive("output_format", __FUNCTION__, __LINE__);
+        nvarStatus = nvarSetOutputFormat(nvar, static_cast<nvarOutputFormat_t>(outputFormat));
         if (nvarStatus == NVAR_STATUS_SUCCESS) {
-            // Success
+            contextSettings["output_format"] = outputFormat;
         } else {
             printError(nvarStatus, __FUNCTION__, __LINE__);
         }
@@ -292,7 +691,7 @@ public:
 
         nvarStatus = nvarSetDecayFactor(nvar, decayFactor);
         if (nvarStatus == NVAR_STATUS_SUCCESS) {
-            // Success
+            contextSettings["decay_factor"] = decayFactor;
         } else {
             printError(nvarStatus, __FUNCTION__, __LINE__);
         }
@@ -318,17 +717,179 @@ public:
 
         nvarStatus = nvarSetUnitLength(nvar, ratio);
         if (nvarStatus == NVAR_STATUS_SUCCESS) {
-            // Success
+            contextSettings["unit_length"] = ratio;
         } else {
             printError(nvarStatus, __FUNCTION__, __LINE__);
         }
     }
 
-    /** Updates the scene's acoustic geometry **/
+    /** Applies several context settings at once: reverb_length, sample_rate,
+     *  output_format, decay_factor and unit_length, each optional. Every
+     *  value is checked before any is applied. The three settings that make
+     *  NVAR reallocate its buffers go first, and only if they change. While
+     *  sources exist or audio is running they are deferred with a warning,
+     *  then applied once the last source is destroyed and audio is stopped.
+     *  Returns false, applying nothing, if a setting is unknown or out of range.
+     */
+    bool configure(Dictionary settings) {
+        nvarStatus_t nvarStatus;
+        Array keys = settings.keys();
+        for (int i = 0; i < keys.size(); i++) {
+            if (!isValidSetting(keys[i], settings[keys[i]])) {
+                printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+                return false;
+            }
+        }
+
+        bool live = isSessionLive();
+        bool deferred = false;
+        for (int i = 0; i < kReallocatingSettings; i++) {
+            String key = reallocatingSetting(i);
+            if (!settings.has(key)) {
+                continue;
+            }
+            if (live) {
+                deferredSettings[key] = settings[key];
+                deferred = true;
+                continue;
+            }
+            nvarStatus = applySetting(key, settings[key]);
+            if (nvarStatus != NVAR_STATUS_SUCCESS) {
+                printError(nvarStatus, __FUNCTION__, __LINE__);
+            }
+        }
+        if (deferred) {
+            Godot::print_warning("Reverb length, sample rate and output format reallocate NVAR's buffers; "
+                                 "deferred until no source exists and audio is stopped", __FUNCTION__, __FILE__, __LINE__);
+        }
+        for (int i = 0; i < kImmediateSettings; i++) {
+            String key = immediateSetting(i);
+            if (!settings.has(key)) {
+                continue;
+            }
+            nvarStatus = applySetting(key, settings[key]);
+            if (nvarStatus != NVAR_STATUS_SUCCESS) {
+                printError(nvarStatus, __FUNCTION__, __LINE__);
+            }
+        }
+        return true;
+    }
+
+    /** Returns the settings configure deferred, which are not applied yet **/
+    Dictionary getDeferredConfiguration() {
+        return deferredSettings;
+    }
+
+    /** Settings that reallocate NVAR's buffers, in the order configure applies them **/
+    static const int kReallocatingSettings = 3;
+
+    static String reallocatingSetting(int index) {
+        // the filter length follows from sample rate and reverb length, so those go last
+        const char* keys[kReallocatingSettings] = { "output_format", "sample_rate", "reverb_length" };
+        return String(keys[index]);
+    }
+
+    /** Settings that are cheap to change at any time **/
+    static const int kImmediateSettings = 2;
+
+    static String immediateSetting(int index) {
+        const char* keys[kImmediateSettings] = { "decay_factor", "unit_length" };
+        return String(keys[index]);
+    }
+
+    /** A scene is live once sources exist or audio runs, and reallocating then
+     *  breaks audio continuity.
+     */
+    bool isSessionLive() {
+        return sources.size() > 0 || audioRenderer.isRunning();
+    }
+
+    void warnIfSessionLive(const char* setting, const char* func, int line) {
+        if (isSessionLive()) {
+            Godot::print_warning(String("Changing ") + String(setting) + String(" with live sources reallocates "
+                                 "NVAR's buffers; configure() defers it instead"), func, __FILE__, line);
+        }
+    }
+
+    static bool isValidSetting(const Variant& key, const Variant& value) {
+        if (key.get_type() != Variant::STRING ||
+            (value.get_type() != Variant::INT && value.get_type() != Variant::REAL)) {
+            return false;
+        }
+        String name = key;
+        double number = value;
+        if (name == "reverb_length" || name == "unit_length") {
+            return number > 0.0;
+        } else if (name == "sample_rate") {
+            return number == std::floor(number) && number >= NVAR_MIN_SAMPLE_RATE;
+        } else if (name == "output_format") {
+            return number == std::floor(number) && number >= 0 && number < NUM_NVAR_OUTPUT_FORMATS;
+        } else if (name == "decay_factor") {
+            return number > 0.0 && number <= 1.0;
+        }
+        return false;
+    }
+
+    /** Applies one validated setting, skipping reallocations that change nothing **/
+    nvarStatus_t applySetting(const String& name, const Variant& value) {
+        nvarStatus_t nvarStatus = NVAR_STATUS_SUCCESS;
+        if (name == "reverb_length") {
+            float reverbLength = 0.0f;
+            nvarGetReverbLength(nvar, &reverbLength);
+            if (reverbLength != (float)value) {
+                nvarStatus = nvarSetReverbLength(nvar, (float)value);
+            }
+        } else if (name == "sample_rate") {
+            int sampleRate = 0;
+            nvarGetSampleRate(nvar, &sampleRate);
+            if (sampleRate != (int64_t)value) {
+                nvarStatus = nvarSetSampleRate(nvar, (int)(int64_t)value);
+            }
+        } else if (name == "output_format") {
+            nvarOutputFormat_t outputFormat = NVAR_DEFAULT_OUTPUT_FORMAT;
+            nvarGetOutputFormat(nvar, &outputFormat);
+            if (outputFormat != (int64_t)value) {
+                nvarStatus = nvarSetOutputFormat(nvar, static_cast<nvarOutputFormat_t>((int64_t)value));
+            }
+        } else if (name == "decay_factor") {
+            nvarStatus = nvarSetDecayFactor(nvar, (float)value);
+        } else if (name == "unit_length") {
+            nvarStatus = nvarSetUnitLength(nvar, (float)value);
+        }
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            contextSettings[name] = value;
+        }
+        return nvarStatus;
+    }
+
+    /** Applies what configure deferred once the session is no longer live **/
+    void applyDeferredSettings() {
+        nvarStatus_t nvarStatus;
+        if (deferredSettings.empty() || isSessionLive() || !nvar) {
+            // without a context they wait for rebuild
+            return;
+        }
+        for (int i = 0; i < kReallocatingSettings; i++) {
+            String key = reallocatingSetting(i);
+            if (!deferredSettings.has(key)) {
+                continue;
+            }
+            nvarStatus = applySetting(key, deferredSettings[key]);
+            if (nvarStatus != NVAR_STATUS_SUCCESS) {
+                printError(nvarStatus, __FUNCTION__, __LINE__);
+            }
+        }
+        deferredSettings.clear();
+    }
+
+    /** Updates the scene's acoustic geometry now, if anything changed since
+     *  the last commit. Not needed for tracing: changed geometry is
+     *  committed before the next trace, at most once per frame.
+     */
     void commitGeometry() {
         nvarStatus_t nvarStatus;
 
-        nvarStatus = nvarCommitGeometry(nvar);
+        nvarStatus = commitDirtyGeometry();
         if (nvarStatus == NVAR_STATUS_SUCCESS) {
             // Success
         } else {
@@ -336,6 +897,33 @@ public:
         }
     }
 
+    /** Returns how often the geometry was committed: commits made, skipped
+     *  because nothing had changed, and deferred to the next frame because
+     *  the frame had already committed once.
+     */
+    Dictionary getGeometryCommitStats() {
+        Dictionary result;
+        result["commits"] = geometryCommits;
+        result["skipped"] = geometryCommitsSkipped;
+        result["deferred"] = geometryCommitsDeferred;
+        return result;
+    }
+
+    nvarStatus_t commitDirtyGeometry() {
+        nvarStatus_t nvarStatus;
+        if (!geometryDirty) {
+            geometryCommitsSkipped++;
+            return NVAR_STATUS_SUCCESS;
+        }
+        nvarStatus = nvarCommitGeometry(nvar);
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            geometryDirty = false;
+            geometryCommits++;
+            geometryCommitFrame = Engine::get_singleton()->get_idle_frames();
+        }
+        return nvarStatus;
+    }
+
     /** Exports NVAR geometry to Wavefront .obj file. **/
     void exportOBJs(String objFileBaseName) {
         nvarStatus_t nvarStatus;
@@ -371,7 +959,7 @@ public:
         nLocation.y = location.y;
         nLocation.z = location.z;
 
-        nvarStatus = nvarSetListenerLocation(nvar, nLocation);
+        nvarStatus = applyListenerLocation(nLocation);
         if (nvarStatus == NVAR_STATUS_SUCCESS) {
             // Success
         } else {
@@ -421,7 +1009,7 @@ public:
         nUpAxis.y = upAxis.y;
         nUpAxis.z = upAxis.z;
 
-        nvarStatus = nvarSetListenerOrientation(nvar, nForwardAxis, nUpAxis);
+        nvarStatus = applyListenerOrientation(nForwardAxis, nUpAxis);
         if (nvarStatus == NVAR_STATUS_SUCCESS) {
             // Success
         } else {
@@ -429,11 +1017,47 @@ public:
         }
     }
 
-    /** Queue a trace of the audio paths between listener and sound sources **/
+    /** Requests a trace of the audio paths between listener and sound sources.
+     *  Requests are coalesced until the end of the frame, and at most
+     *  max_traces_in_flight traces are queued at once; trace_completed is
+     *  emitted when each one finishes.
+     */
     void traceAudio() {
+        if (!traceScheduler.isRunning()) { // No context has been created.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return;
+        }
+        tracePending = true;
+        if (!traceFlushQueued) {
+            traceFlushQueued = true;
+            call_deferred("_flush_traces");
+        }
+    }
+
+    /** Issues the coalesced trace request if there is room in the queue **/
+    void _flush_traces() {
         nvarStatus_t nvarStatus;
+        uint64_t traceNumber;
+        traceFlushQueued = false;
+        if (!tracePending || !traceScheduler.canIssue()) {
+            // still pending traces are issued when one completes
+            return;
+        }
+
+        // traces see changed geometry, committed at most once per frame
+        if (geometryDirty && geometryCommitFrame == Engine::get_singleton()->get_idle_frames()) {
+            // the trace waits for the next frame's commit rather than tracing the old geometry
+            geometryCommitsDeferred++;
+            deferFlushToNextFrame();
+            return;
+        }
+        nvarStatus = commitDirtyGeometry();
+        if (nvarStatus != NVAR_STATUS_SUCCESS) {
+            printError(nvarStatus, __FUNCTION__, __LINE__);
+        }
 
-        nvarStatus = nvarTraceAudio(nvar, NULL);
+        tracePending = false;
+        nvarStatus = traceScheduler.issue(nvar, traceNumber);
         if (nvarStatus == NVAR_STATUS_SUCCESS) {
             // Success
         } else {
@@ -441,6 +1065,50 @@ public:
         }
     }
 
+    /** Flushes the pending trace on the next idle frame. A call_deferred
+     *  would run in this frame's message queue flush again.
+     */
+    void deferFlushToNextFrame() {
+        SceneTree* tree = Object::cast_to<SceneTree>(Engine::get_singleton()->get_main_loop());
+        if (!tree) {
+            // without a scene tree the next trace_audio or completed trace flushes it
+            return;
+        }
+        traceFlushQueued = true;
+        if (!tree->is_connected("idle_frame", this, "_flush_traces")) {
+            tree->connect("idle_frame", this, "_flush_traces", Array(), CONNECT_ONESHOT);
+        }
+    }
+
+    /** Called on the main thread once a trace has finished, with the time
+     *  NVAR spent on it.
+     */
+    void _on_trace_completed(int64_t traceNumber, float milliseconds) {
+        effectBudget.observe(traceNumber, milliseconds);
+        if (audioRenderer.isRunning()) {
+            audioRenderer.updateFilters();
+        }
+        emit_signal("trace_completed", traceNumber);
+        if (tracePending) {
+            _flush_traces();
+        }
+    }
+
+    /** Sets how many traces may be queued in NVAR at once **/
+    void setMaxTracesInFlight(int count) {
+        traceScheduler.setMaxInFlight(count);
+    }
+
+    /** Returns how many traces may be queued in NVAR at once **/
+    int getMaxTracesInFlight() {
+        return traceScheduler.getMaxInFlight();
+    }
+
+    /** Returns the number of traces queued and not yet completed **/
+    int getTracesInFlight() {
+        return traceScheduler.getInFlight();
+    }
+
     /** Records an event in nvar command queue **/
     void eventRecord(HANDLE hEvent) {
         // Not sure how to implement this, or if it's useful in Godot, so I won't.
@@ -459,52 +1127,62 @@ public:
         }
     }
 
-    /** Creates an acoustic material with default properties and the given id **/
-    void createMaterial(godot::String id) {
+    /** Creates an acoustic material with default properties. The optional name can be
+     *  used to look the material up later. Returns the material id.
+     */
+    Variant createMaterial(godot::String name) {
         nvarStatus_t nvarStatus;
-        nvarMaterial_t material;
-        if (materials.count(id) > 0) {// A material with this id already exists.
+        MaterialState material;
+        if (materialNames.has(name)) {// A material with this name already exists.
             printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
-            return;
+            return Variant();
         }
 
-        nvarStatus = nvarCreateMaterial(nvar, &material);
+        nvarStatus = createMaterialState(-1, material);
         if (nvarStatus == NVAR_STATUS_SUCCESS) {
-            materials[id] = &material;
+            int64_t id = materials.insert(material);
+            materialNames.bind(name, id);
+            return Variant(id);
         } else {
             printError(nvarStatus, __FUNCTION__, __LINE__);
         }
+        return Variant();
     }
 
-    /** Creates a predefined acoustic material **/
-    void createPredefinedMaterial(godot::String id, int predefined_material) {
+    /** Creates a predefined acoustic material. Returns the material id. **/
+    Variant createPredefinedMaterial(godot::String name, int predefined_material) {
         nvarStatus_t nvarStatus;
-        nvarMaterial_t material;
-        if (materials.count(id) > 0) {// A material with this id already exists.
+        MaterialState material;
+        if (materialNames.has(name)) {// A material with this name already exists.
             printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
-            return;
+            return Variant();
         }
 
-        nvarStatus = nvarCreatePredefinedMaterial(nvar, &material, static_cast<nvarPredefinedMaterial_t>(predefined_material));
+        nvarStatus = createMaterialState(predefined_material, material);
         if (nvarStatus == NVAR_STATUS_SUCCESS) {
-            materials[id] = &material;
+            int64_t id = materials.insert(material);
+            materialNames.bind(name, id);
+            return Variant(id);
         } else {
             printError(nvarStatus, __FUNCTION__, __LINE__);
         }
+        return Variant();
     }
 
     /** Destroys the specified acoustic material **/
-    void destroyMaterial(godot::String id) {
+    void destroyMaterial(int64_t id) {
         nvarStatus_t nvarStatus;
-        if (materials.count(id) == 0) { // No material with this id exists.
+        MaterialState* material = materials.get(id);
+        if (!material) { // No material with this id exists.
             printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
             return;
         }
-        nvarMaterial_t* material = materials[id];
 
-        nvarStatus = nvarDestroyMaterial(*material);
+        nvarStatus = nvarDestroyMaterial(material->handle);
         if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            geometryDirty = true;
             materials.erase(id);
+            materialNames.unbind(id);
         } else {
             printError(nvarStatus, __FUNCTION__, __LINE__);
         }
@@ -513,23 +1191,32 @@ public:
     /** Returns an array of created material IDs */
     Variant getMaterialIDs() {
         godot::Array out;
-        for(std::map<godot::String, nvarMaterial_t*>::iterator it = materials.begin(); it != materials.end(); ++it) {
-            out.push_back(it->first);
+        for (int i = 0; i < materials.size(); i++) {
+            out.push_back(materials.idAt(i));
         }
         return Variant(out);
     }
 
+    /** Returns the id of the material created with the given name **/
+    Variant findMaterial(godot::String name) {
+        if (!materialNames.has(name)) { // No material with this name exists.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return Variant();
+        }
+        return Variant(materialNames.find(name));
+    }
+
     /** Gets the reflection coefficient of the acoustic material **/
-    Variant getMaterialReflection(godot::String id) {
+    Variant getMaterialReflection(int64_t id) {
         nvarStatus_t nvarStatus;
         float reflection;
-        if (materials.count(id) == 0) { // No material with this id exists.
+        MaterialState* material = materials.get(id);
+        if (!material) { // No material with this id exists.
             printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
             return Variant();
         }
-        nvarMaterial_t* material = materials[id];
 
-        nvarStatus = nvarGetMaterialReflection(*material, &reflection);
+        nvarStatus = nvarGetMaterialReflection(material->handle, &reflection);
         if (nvarStatus == NVAR_STATUS_SUCCESS) {
             return Variant(reflection);
         } else {
@@ -539,15 +1226,10 @@ public:
     }
 
     /** Sets the reflection coefficient of the acoustic material **/
-    void setMaterialReflection(godot::String id, const float reflection) {
+    void setMaterialReflection(int64_t id, const float reflection) {
         nvarStatus_t nvarStatus;
-        if (materials.count(id) == 0) { // No material with this id exists.
-            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
-            return;
-        }
-        nvarMaterial_t* material = materials[id];
 
-        nvarStatus = nvarSetMaterialReflection(*material, reflection);
+        nvarStatus = applyMaterialCoefficient(id, reflection, true);
         if (nvarStatus == NVAR_STATUS_SUCCESS) {
             // Success
         } else {
@@ -556,16 +1238,16 @@ public:
     }
 
     /** Gets the transmission coefficient of the acoustic material **/
-    Variant getMaterialTransmission(godot::String id) {
+    Variant getMaterialTransmission(int64_t id) {
         nvarStatus_t nvarStatus;
         float transmission;
-        if (materials.count(id) == 0) { // No material with this id exists.
+        MaterialState* material = materials.get(id);
+        if (!material) { // No material with this id exists.
             printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
             return Variant();
         }
-        nvarMaterial_t* material = materials[id];
 
-        nvarStatus = nvarGetMaterialTransmission(*material, &transmission);
+        nvarStatus = nvarGetMaterialTransmission(material->handle, &transmission);
         if (nvarStatus == NVAR_STATUS_SUCCESS) {
             return Variant(transmission);
         } else {
@@ -575,15 +1257,10 @@ public:
     }
     
     /** Sets the transmission coefficient of the acoustic material **/
-    void setMaterialTransmission(godot::String id, const float transmission) {
+    void setMaterialTransmission(int64_t id, const float transmission) {
         nvarStatus_t nvarStatus;
-        if (materials.count(id) == 0) { // No material with this id exists.
-            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
-            return;
-        }
-        nvarMaterial_t* material = materials[id];
 
-        nvarStatus = nvarSetMaterialTransmission(*material, transmission);
+        nvarStatus = applyMaterialCoefficient(id, transmission, false);
         if (nvarStatus == NVAR_STATUS_SUCCESS) {
             // Success
         } else {
@@ -591,6 +1268,57 @@ public:
         }
     }
 
+    /** Creates the NVAR material of a material state, predefined if
+     *  predefined is not negative, and records its coefficients.
+     */
+    nvarStatus_t createMaterialState(int predefined, MaterialState& state) {
+        nvarStatus_t nvarStatus;
+
+        nvarStatus = predefined < 0 ? nvarCreateMaterial(nvar, &state.handle) :
+            nvarCreatePredefinedMaterial(nvar, &state.handle, static_cast<nvarPredefinedMaterial_t>(predefined));
+        if (nvarStatus != NVAR_STATUS_SUCCESS) {
+            state.handle = NULL;
+            return nvarStatus;
+        }
+        state.predefined = predefined;
+        nvarGetMaterialReflection(state.handle, &state.reflection);
+        nvarGetMaterialTransmission(state.handle, &state.transmission);
+        return NVAR_STATUS_SUCCESS;
+    }
+
+    /** Creates a recorded material in the current context with its last coefficients **/
+    nvarStatus_t restoreMaterial(MaterialState& state) {
+        nvarStatus_t nvarStatus;
+        float reflection = state.reflection;
+        float transmission = state.transmission;
+
+        nvarStatus = createMaterialState(state.predefined, state);
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            nvarStatus = nvarSetMaterialReflection(state.handle, reflection);
+        }
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            nvarStatus = nvarSetMaterialTransmission(state.handle, transmission);
+        }
+        state.reflection = reflection;
+        state.transmission = transmission;
+        return nvarStatus;
+    }
+
+    nvarStatus_t applyMaterialCoefficient(int64_t id, float value, bool reflection) {
+        nvarStatus_t nvarStatus;
+        MaterialState* material = materials.get(id);
+        if (!material) {
+            return NVAR_STATUS_INVALID_VALUE;
+        }
+        nvarStatus = reflection ? nvarSetMaterialReflection(material->handle, value) :
+                                  nvarSetMaterialTransmission(material->handle, value);
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            (reflection ? material->reflection : material->transmission) = value;
+            geometryDirty = true;
+        }
+        return nvarStatus;
+    }
+
     /** Converts Godot 3D transform to NVAR's 4x4 matrix **/
     const nvarMatrix4x4_t getNvarTransformFromGodotTransform(godot::Transform gTransform) {
         nvarMatrix4x4_t nTransform;
@@ -619,106 +1347,1213 @@ public:
         return nTransform;
     }
 
-    /** Creates an acoustic mesh **/
-    void createMesh(godot::String id,
+    /** Creates an acoustic mesh. The optional name can be used to look the
+     *  mesh up later. Returns the mesh id. Inside a geometry batch the mesh
+     *  gets its id right away but is only created in NVAR by
+     *  end_geometry_batch.
+     */
+    Variant createMesh(godot::String name,
                     godot::Transform gTransform,
                     const godot::Ref<Mesh> gMeshRef,
-                    godot::String materialID) {
+                    int64_t materialID) {
         nvarStatus_t nvarStatus;
-        nvarMesh_t nMesh;
+        MeshState mesh;
         // check that mesh does not exist, and that material does exist.
-        if (meshes.count(id) > 0 || materials.count(materialID) == 0) {
+        MaterialState* material = materials.get(materialID);
+        if (meshNames.has(name) || !material) {
             printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
-            return;
+            return Variant();
         }
-        // get pointer to the selected material
-        nvarMaterial_t* material = materials[materialID];
         // convert transform
-        const nvarMatrix4x4_t nTransform = getNvarTransformFromGodotTransform(gTransform);
-
-        // get vertices and face count
-        godot::PoolVector3Array gVertices = gMeshRef->get_faces();
-        int numVertices = gVertices.size();
-        int numFaces = numVertices/3;
+        mesh.transform = getNvarTransformFromGodotTransform(gTransform);
+        mesh.material = materialID;
 
-        // convert vertices
-        nvarFloat3_t* nVertices = new nvarFloat3_t[numVertices];
-        for (int i = 0; i < numVertices; i++) {
-            nVertices[i].x = gVertices[i].x;
-            nVertices[i].y = gVertices[i].y;
-            nVertices[i].z = gVertices[i].z;
+        if (gMeshRef.is_null() || !convertMesh(gMeshRef, mesh)) {
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return Variant();
         }
 
-        // Interpret vertices into faces. In Godot all faces are tris, 
-        // so every three vertices is a face. Not sure exactly the 
-        // numbering scheme NVAR wants, the demo project is unclear.
-        int* faces = new int[numVertices];
-        for (int f = 0; f < numFaces; ++f) {
-            int i = f*3;
-            faces[i] = f;
-            faces[i+1] = f;
-            faces[i+2] = f;
+        if (geometryBatchDepth > 0) {
+            int64_t id = meshes.insert(mesh);
+            meshNames.bind(name, id);
+            batchMeshes.push_back(id);
+            return Variant(id);
         }
-
-        nvarStatus = nvarCreateMesh(nvar, &nMesh, nTransform, nVertices,
-                    numVertices, faces, numFaces, *material);
+        nvarStatus = createMeshState(mesh, material->handle);
         if (nvarStatus == NVAR_STATUS_SUCCESS) {
-            meshes[id] = &nMesh;
+            geometryDirty = true;
+            int64_t id = meshes.insert(mesh);
+            meshNames.bind(name, id);
+            return Variant(id);
         } else {
             printError(nvarStatus, __FUNCTION__, __LINE__);
         }
+        return Variant();
+    }
+
+    /** Gives a mesh state the converted geometry of a Godot Mesh. The
+     *  geometry cache is asked first; otherwise the surfaces are converted
+     *  into a geometry of the Mesh's own, which is kept so a rebuilt
+     *  context does not need the Mesh again. Returns false if the Mesh has
+     *  no triangles.
+     */
+    bool convertMesh(const Ref<Mesh>& gMesh, MeshState& mesh) {
+        RID rid = gMesh->get_rid();
+        int64_t key = rid.is_valid() ? (int64_t)rid.get_id() : 0;
+        if (key != 0 && geometryCache.find(key, mesh.geometry)) {
+            return true;
+        }
+
+        // gather shared vertices and triangle indices from the mesh surfaces
+        meshBuilder.clear();
+        if (!meshBuilder.appendMesh(gMesh)) {
+            return false;
+        }
+        std::shared_ptr<MeshGeometry> geometry = std::make_shared<MeshGeometry>();
+        geometry->assign(meshBuilder);
+        mesh.geometry = geometry;
+        meshBuilder.clear();
+        if (key != 0) {
+            geometryCache.store(key, mesh.geometry);
+            if (!gMesh->is_connected("changed", this, "_on_mesh_changed")) {
+                gMesh->connect("changed", this, "_on_mesh_changed", Array::make(key));
+            }
+        }
+        return true;
+    }
+
+    /** Called when a cached Mesh resource changed **/
+    void _on_mesh_changed(int64_t key) {
+        geometryCache.invalidate(key);
+    }
+
+    /** Returns how often create_mesh found a Mesh's converted geometry in
+     *  the cache (hits) or had to convert it (misses), and how many Meshes
+     *  the cache knows.
+     */
+    Dictionary getGeometryCacheStats() {
+        Dictionary result;
+        result["hits"] = geometryCache.getHits();
+        result["misses"] = geometryCache.getMisses();
+        result["entries"] = geometryCache.size();
+        return result;
     }
 
     /** Destroys the specified acoustic mesh **/
-    void destroyMesh(godot::String id) {
+    void destroyMesh(int64_t id) {
         nvarStatus_t nvarStatus;
-        if (meshes.count(id) == 0) { // No material with this id exists.
+        MeshState* mesh = meshes.get(id);
+        if (!mesh) { // No mesh with this id exists.
             printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
             return;
         }
 
-        nvarMesh_t* mesh = meshes[id];
-
-        nvarStatus = nvarDestroyMesh(*mesh);
+        // meshes still waiting for end_geometry_batch have no NVAR mesh yet
+        nvarStatus = mesh->handle ? nvarDestroyMesh(mesh->handle) : NVAR_STATUS_SUCCESS;
         if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            geometryDirty |= mesh->handle != NULL;
             meshes.erase(id);
+            meshNames.unbind(id);
         } else {
             printError(nvarStatus, __FUNCTION__, __LINE__);
         }
     }
 
-    /** Gets the id of the acoustic material of the mesh **/
-
-    /** Create a sound source **/
-    void createSource(godot::String id, int effect) {
+    /** Moves an acoustic mesh without recreating it. Moves smaller than the
+     *  mesh transform epsilons are skipped.
+     */
+    void setMeshTransform(int64_t id, godot::Transform gTransform) {
         nvarStatus_t nvarStatus;
-        nvarSource_t source;
-        if (materials.count(id) > 0) {// A material with this id already exists.
-            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
-            return;
-        }
 
-        nvarStatus = nvarCreateSource(nvar, static_cast<nvarEffect_t>(effect), &source);
+        nvarStatus = applyMeshTransform(id, getNvarTransformFromGodotTransform(gTransform));
         if (nvarStatus == NVAR_STATUS_SUCCESS) {
-            sources[id] = &source;
+            // Success
         } else {
             printError(nvarStatus, __FUNCTION__, __LINE__);
         }
     }
 
-    /** Register methods, members, and signals to expose them to Godot **/
-    static void _register_methods() {
-        register_method("get_version", &GodotNVAR::getVersion);
-        register_method("initialize", &GodotNVAR::initialize);
-        register_method("finalize", &GodotNVAR::finalize);
-        register_method("get_initialize_flags", &GodotNVAR::getInitializeFlags);
-        register_method("get_device_count", &GodotNVAR::getDeviceCount);
-        register_method("get_device_name", &GodotNVAR::getDeviceName);
-        register_method("get_preferred_device", &GodotNVAR::getPreferredDevice);
-        register_method("create", &GodotNVAR::create);
-        register_method("destroy", &GodotNVAR::destroy);
-        register_method("get_device_num", &GodotNVAR::getDeviceNum);
-        register_method("get_reverb_length", &GodotNVAR::getReverbLength);
+    /** Moves many acoustic meshes: ids[i] gets transforms[i]. Returns the
+     *  number of meshes that moved far enough to be updated.
+     */
+    int setMeshTransforms(Array ids, Array transforms) {
+        nvarStatus_t nvarStatus;
+        if (ids.size() != transforms.size()) {
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return 0;
+        }
+
+        int applied = meshTransformsApplied;
+        for (int i = 0; i < ids.size(); i++) {
+            nvarStatus = applyMeshTransform((int64_t)ids[i], getNvarTransformFromGodotTransform(transforms[i]));
+            if (nvarStatus == NVAR_STATUS_SUCCESS) {
+                // Success
+            } else {
+                printError(nvarStatus, __FUNCTION__, __LINE__);
+            }
+        }
+        return meshTransformsApplied - applied;
+    }
+
+    /** Sets how far a mesh must move before set_mesh_transform updates it:
+     *  translation in geometry units, and basis as the largest change of
+     *  any basis element, about the rotation in radians. 0 updates on any change.
+     */
+    void setMeshTransformEpsilon(float translation, float basis) {
+        if (translation < 0.0f || basis < 0.0f) {
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return;
+        }
+        meshTranslationEpsilon = translation;
+        meshBasisEpsilon = basis;
+    }
+
+    /** Returns the mesh transform epsilons as translation and basis **/
+    Dictionary getMeshTransformEpsilon() {
+        Dictionary result;
+        result["translation"] = meshTranslationEpsilon;
+        result["basis"] = meshBasisEpsilon;
+        return result;
+    }
+
+    /** Returns how many mesh transforms were applied and how many skipped
+     *  for moving less than the epsilons.
+     */
+    Dictionary getMeshTransformStats() {
+        Dictionary result;
+        result["applied"] = meshTransformsApplied;
+        result["skipped"] = meshTransformsSkipped;
+        return result;
+    }
+
+    /** Returns the id of the mesh created with the given name **/
+    Variant findMesh(godot::String name) {
+        if (!meshNames.has(name)) { // No mesh with this name exists.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return Variant();
+        }
+        return Variant(meshNames.find(name));
+    }
+
+    /** Starts a geometry batch: create_mesh only converts its mesh and
+     *  stages it, and end_geometry_batch creates every staged NVAR mesh and
+     *  commits the geometry once. Batches nest; the outermost end finishes
+     *  them.
+     */
+    void beginGeometryBatch() {
+        if (geometryBatchDepth++ == 0) {
+            batchMeshes.clear();
+        }
+    }
+
+    /** Creates the NVAR meshes of the batch and commits the geometry once.
+     *  Returns the number of meshes created.
+     */
+    int endGeometryBatch() {
+        nvarStatus_t nvarStatus;
+        if (geometryBatchDepth == 0) { // No geometry batch was begun.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return 0;
+        }
+        if (--geometryBatchDepth > 0) {
+            return 0;
+        }
+
+        int created = 0;
+        for (size_t i = 0; i < batchMeshes.size(); i++) {
+            MeshState* mesh = meshes.get(batchMeshes[i]);
+            if (!mesh) {
+                // destroyed before the batch ended
+                continue;
+            }
+            MaterialState* material = materials.get(mesh->material);
+            nvarStatus = material ? createMeshState(*mesh, material->handle) : NVAR_STATUS_INVALID_VALUE;
+            if (nvarStatus == NVAR_STATUS_SUCCESS) {
+                created++;
+            } else {
+                // the id was handed out already, but there is no mesh behind it
+                meshes.erase(batchMeshes[i]);
+                meshNames.unbind(batchMeshes[i]);
+                printError(nvarStatus, __FUNCTION__, __LINE__);
+            }
+        }
+        batchMeshes.clear();
+
+        geometryDirty |= created > 0;
+        nvarStatus = commitDirtyGeometry();
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            // Success
+        } else {
+            printError(nvarStatus, __FUNCTION__, __LINE__);
+        }
+        return created;
+    }
+
+    /** Creates many acoustic meshes in one geometry batch. Each element is a
+     *  Dictionary with mesh and material and optionally name and transform,
+     *  as create_mesh takes them. Returns an Array with the id of each mesh,
+     *  or null where one could not be created.
+     */
+    Array createMeshes(Array descriptions) {
+        Array ids;
+        beginGeometryBatch();
+        for (int i = 0; i < descriptions.size(); i++) {
+            if (descriptions[i].get_type() != Variant::DICTIONARY) {
+                printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+                ids.push_back(Variant());
+                continue;
+            }
+            Dictionary description = descriptions[i];
+            String name = description.has("name") ? (String)description["name"] : String();
+            Transform transform = description.has("transform") ? (Transform)description["transform"] : Transform();
+            Ref<Mesh> mesh = description["mesh"];
+            ids.push_back(createMesh(name, transform, mesh, (int64_t)description["material"]));
+        }
+        endGeometryBatch();
+        // ids of meshes NVAR refused are stale now
+        for (int i = 0; i < ids.size(); i++) {
+            if (ids[i].get_type() == Variant::INT && !meshes.contains((int64_t)ids[i])) {
+                ids[i] = Variant();
+            }
+        }
+        return ids;
+    }
+
+    /** Creates an acoustic mesh for every visible instance of a
+     *  MultiMeshInstance, placed by its global transform, in one geometry
+     *  batch. The MultiMesh's Mesh is converted once. Returns an Array with
+     *  the ids of the meshes created.
+     */
+    Array importMultiMesh(MultiMeshInstance* instance, int64_t materialID) {
+        Array ids;
+        Ref<MultiMesh> multiMesh = instance ? instance->get_multimesh() : Ref<MultiMesh>();
+        if (multiMesh.is_null() || multiMesh->get_transform_format() != MultiMesh::TRANSFORM_3D ||
+            multiMesh->get_mesh().is_null() || !materials.get(materialID)) {
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return ids;
+        }
+        int count = (int)multiMesh->get_instance_count();
+        int visible = (int)multiMesh->get_visible_instance_count();
+        count = visible >= 0 ? std::min(count, visible) : count;
+
+        importColumns.resize(12 * count);
+        for (int i = 0; i < count; i++) {
+            Transform t = multiMesh->get_instance_transform(i);
+            float* columns = &importColumns[12 * i];
+            for (int axis = 0; axis < 3; axis++) {
+                columns[3 * axis + 0] = (float)t.basis.elements[0][axis];
+                columns[3 * axis + 1] = (float)t.basis.elements[1][axis];
+                columns[3 * axis + 2] = (float)t.basis.elements[2][axis];
+            }
+            columns[9] = (float)t.origin.x;
+            columns[10] = (float)t.origin.y;
+            columns[11] = (float)t.origin.z;
+        }
+        composeInstances(instance->get_global_transform(), importColumns.data(), count);
+        importItems.assign(count, 0);
+        importMeshes.clear();
+        importMeshes.push_back(multiMesh->get_mesh());
+        return stageInstances(materialID);
+    }
+
+    /** Creates an acoustic mesh for every used cell of a GridMap, placed as
+     *  the GridMap places the cell's item, in one geometry batch. Each item
+     *  Mesh of the MeshLibrary is converted once. Returns an Array with the
+     *  ids of the meshes created.
+     */
+    Array importGridMap(GridMap* gridMap, int64_t materialID) {
+        Array ids;
+        Ref<MeshLibrary> library = gridMap ? gridMap->get_mesh_library() : Ref<MeshLibrary>();
+        if (library.is_null() || !materials.get(materialID)) {
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return ids;
+        }
+        Array cells = gridMap->get_used_cells();
+        Vector3 cellSize = gridMap->get_cell_size();
+        float scale = gridMap->get_cell_scale();
+        // GridMap's cell offset, half a cell on the centered axes
+        Vector3 offset(gridMap->get_center_x() ? cellSize.x * 0.5f : 0.0f,
+                       gridMap->get_center_y() ? cellSize.y * 0.5f : 0.0f,
+                       gridMap->get_center_z() ? cellSize.z * 0.5f : 0.0f);
+
+        std::unordered_map<int64_t, int> itemIndex;
+        importMeshes.clear();
+        importItems.clear();
+        importColumns.clear();
+        importItems.reserve(cells.size());
+        importColumns.reserve(12 * cells.size());
+        for (int i = 0; i < cells.size(); i++) {
+            Vector3 cell = cells[i];
+            int64_t x = (int64_t)cell.x;
+            int64_t y = (int64_t)cell.y;
+            int64_t z = (int64_t)cell.z;
+            int64_t item = gridMap->get_cell_item(x, y, z);
+            if (item < 0) {
+                continue;
+            }
+            std::unordered_map<int64_t, int>::iterator found = itemIndex.find(item);
+            if (found == itemIndex.end()) {
+                found = itemIndex.insert(std::make_pair(item, (int)importMeshes.size())).first;
+                importMeshes.push_back(library->get_item_mesh(item));
+            }
+            importItems.push_back(found->second);
+
+            const float* basis = orthogonalBasis((int)gridMap->get_cell_item_orientation(x, y, z));
+            for (int axis = 0; axis < 3; axis++) {
+                // the table holds rows, the transform buffer wants the axes
+                importColumns.push_back(basis[axis] * scale);
+                importColumns.push_back(basis[3 + axis] * scale);
+                importColumns.push_back(basis[6 + axis] * scale);
+            }
+            importColumns.push_back(x * cellSize.x + offset.x);
+            importColumns.push_back(y * cellSize.y + offset.y);
+            importColumns.push_back(z * cellSize.z + offset.z);
+        }
+        composeInstances(gridMap->get_global_transform(), importColumns.data(), (int)importItems.size());
+        return stageInstances(materialID);
+    }
+
+    /** The 24 rotations a GridMap cell can have, as rows, in Godot's
+     *  orthogonal index order.
+     */
+    static const float* orthogonalBasis(int index) {
+        static const float bases[24][9] = {
+            { 1, 0, 0, 0, 1, 0, 0, 0, 1 }, { 0, -1, 0, 1, 0, 0, 0, 0, 1 },
+            { -1, 0, 0, 0, -1, 0, 0, 0, 1 }, { 0, 1, 0, -1, 0, 0, 0, 0, 1 },
+            { 1, 0, 0, 0, 0, -1, 0, 1, 0 }, { 0, 0, 1, 1, 0, 0, 0, 1, 0 },
+            { -1, 0, 0, 0, 0, 1, 0, 1, 0 }, { 0, 0, -1, -1, 0, 0, 0, 1, 0 },
+            { 1, 0, 0, 0, -1, 0, 0, 0, -1 }, { 0, 1, 0, 1, 0, 0, 0, 0, -1 },
+            { -1, 0, 0, 0, 1, 0, 0, 0, -1 }, { 0, -1, 0, -1, 0, 0, 0, 0, -1 },
+            { 1, 0, 0, 0, 0, 1, 0, -1, 0 }, { 0, 0, -1, 1, 0, 0, 0, -1, 0 },
+            { -1, 0, 0, 0, 0, -1, 0, -1, 0 }, { 0, 0, 1, -1, 0, 0, 0, -1, 0 },
+            { 0, 0, 1, 0, 1, 0, -1, 0, 0 }, { 0, -1, 0, 0, 0, 1, -1, 0, 0 },
+            { 0, 0, -1, 0, -1, 0, -1, 0, 0 }, { 0, 1, 0, 0, 0, -1, -1, 0, 0 },
+            { 0, 0, 1, 0, -1, 0, 1, 0, 0 }, { 0, 1, 0, 0, 0, 1, 1, 0, 0 },
+            { 0, 0, -1, 0, 1, 0, 1, 0, 0 }, { 0, -1, 0, 0, 0, -1, 1, 0, 0 },
+        };
+        return bases[index >= 0 && index < 24 ? index : 0];
+    }
+
+    /** Fills importTransforms with parent times each instance transform **/
+    void composeInstances(const Transform& parent, const float* instances, int count) {
+        float columns[12];
+        for (int axis = 0; axis < 3; axis++) {
+            columns[3 * axis + 0] = parent.basis.elements[0][axis];
+            columns[3 * axis + 1] = parent.basis.elements[1][axis];
+            columns[3 * axis + 2] = parent.basis.elements[2][axis];
+        }
+        columns[9] = parent.origin.x;
+        columns[10] = parent.origin.y;
+        columns[11] = parent.origin.z;
+        importTransforms.resize(count);
+        TransformBatch::compose(columns, instances, count, importTransforms.data());
+    }
+
+    /** Creates one mesh per importTransforms entry, using the Mesh
+     *  importMeshes[importItems[i]], in one geometry batch.
+     */
+    Array stageInstances(int64_t materialID) {
+        Array ids;
+        beginGeometryBatch();
+        std::vector<MeshState> prototypes(importMeshes.size());
+        std::vector<bool> converted(importMeshes.size());
+        for (size_t i = 0; i < importMeshes.size(); i++) {
+            prototypes[i].material = materialID;
+            converted[i] = importMeshes[i].is_valid() && convertMesh(importMeshes[i], prototypes[i]);
+        }
+        for (size_t i = 0; i < importTransforms.size(); i++) {
+            if (!converted[importItems[i]]) {
+                // items without a Mesh or triangles have nothing to reflect sound
+                continue;
+            }
+            MeshState mesh = prototypes[importItems[i]];
+            mesh.transform = importTransforms[i];
+            int64_t id = meshes.insert(mesh);
+            batchMeshes.push_back(id);
+            ids.push_back(id);
+        }
+        endGeometryBatch();
+        importMeshes.clear();
+        // ids of meshes NVAR refused are stale now
+        Array created;
+        for (int i = 0; i < ids.size(); i++) {
+            if (meshes.contains((int64_t)ids[i])) {
+                created.push_back(ids[i]);
+            }
+        }
+        return created;
+    }
+
+    /** Creates the NVAR mesh of a mesh state from its cached geometry **/
+    nvarStatus_t createMeshState(MeshState& mesh, nvarMaterial_t material) {
+        nvarStatus_t nvarStatus;
+        const MeshGeometry& geometry = *mesh.geometry;
+
+        nvarStatus = nvarCreateMesh(nvar, &mesh.handle, mesh.transform, geometry.getVertices(),
+                    geometry.getNumVertices(), geometry.getFaces(), geometry.getNumFaces(), material);
+        if (nvarStatus != NVAR_STATUS_SUCCESS) {
+            mesh.handle = NULL;
+        }
+        return nvarStatus;
+    }
+
+    nvarStatus_t applyMeshTransform(int64_t id, const nvarMatrix4x4_t& transform) {
+        nvarStatus_t nvarStatus;
+        MeshState* mesh = meshes.get(id);
+        if (!mesh) {
+            return NVAR_STATUS_INVALID_VALUE;
+        }
+        if (!mesh->handle) {
+            // still in a geometry batch, created with this transform later
+            mesh->transform = transform;
+            return NVAR_STATUS_SUCCESS;
+        }
+        // small moves are dropped, but measured from the last applied transform so they add up
+        if (!mesh->movedBeyond(transform, meshTranslationEpsilon, meshBasisEpsilon)) {
+            meshTransformsSkipped++;
+            return NVAR_STATUS_SUCCESS;
+        }
+        nvarStatus = nvarSetMeshTransform(mesh->handle, transform);
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            mesh->transform = transform;
+            meshTransformsApplied++;
+            geometryDirty = true;
+        }
+        return nvarStatus;
+    }
+
+    /** Create a sound source. The optional name can be used to look the
+     *  source up later. Returns the source id.
+     */
+    Variant createSource(godot::String name, int effect) {
+        nvarStatus_t nvarStatus;
+        SourceState state(static_cast<nvarEffect_t>(effect));
+        if (sourceNames.has(name)) {// A source with this name already exists.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return Variant();
+        }
+
+        // over budget, start virtual and let update_source_budget decide
+        if (voiceBudget.getMaxLive() > 0 && liveSources >= voiceBudget.getMaxLive()) {
+            int64_t id = sources.insert(state);
+            sourceNames.bind(name, id);
+            return Variant(id);
+        }
+
+        nvarStatus = realizeSource(state);
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            int64_t id = sources.insert(state);
+            sourceNames.bind(name, id);
+            return Variant(id);
+        } else {
+            printError(nvarStatus, __FUNCTION__, __LINE__);
+        }
+        return Variant();
+    }
+
+    /** Destroys the specified sound source **/
+    void destroySource(int64_t id) {
+        nvarStatus_t nvarStatus;
+        SourceState* source = sources.get(id);
+        if (!source) { // No source with this id exists.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return;
+        }
+
+        nvarStatus = source->isLive() ? parkSource(*source) : NVAR_STATUS_SUCCESS;
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            sources.erase(id);
+            sourceNames.unbind(id);
+            applyDeferredSettings();
+        } else {
+            printError(nvarStatus, __FUNCTION__, __LINE__);
+        }
+    }
+
+    /** Sets the location of a sound source **/
+    void setSourceLocation(int64_t id, Vector3 location) {
+        nvarStatus_t nvarStatus;
+        nvarFloat3_t nLocation;
+        nLocation.x = location.x;
+        nLocation.y = location.y;
+        nLocation.z = location.z;
+
+        nvarStatus = applySourceLocation(id, nLocation);
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            // Success
+        } else {
+            printError(nvarStatus, __FUNCTION__, __LINE__);
+        }
+    }
+
+    /** Sets the gain of a source's direct path **/
+    void setSourceDirectGain(int64_t id, float gain) {
+        nvarStatus_t nvarStatus;
+
+        nvarStatus = applySourceGain(id, gain, true);
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            // Success
+        } else {
+            printError(nvarStatus, __FUNCTION__, __LINE__);
+        }
+    }
+
+    /** Sets the gain of a source's indirect paths **/
+    void setSourceIndirectGain(int64_t id, float gain) {
+        nvarStatus_t nvarStatus;
+
+        nvarStatus = applySourceGain(id, gain, false);
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            // Success
+        } else {
+            printError(nvarStatus, __FUNCTION__, __LINE__);
+        }
+    }
+
+    /** Sets how much a source's audibility counts toward keeping it live.
+     *  1 by default; 0 makes it the first to be virtualized.
+     */
+    void setSourcePriority(int64_t id, float priority) {
+        SourceState* source = sources.get(id);
+        if (!source) { // No source with this id exists.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return;
+        }
+        source->priority = std::max(priority, 0.0f);
+    }
+
+    /** Limits how many sources keep a live NVAR source; the rest are
+     *  virtualized by update_source_budget. 0 (the default) means no limit.
+     */
+    void setMaxLiveSources(int count) {
+        voiceBudget.setMaxLive(count);
+    }
+
+    /** Returns the live source limit **/
+    int getMaxLiveSources() {
+        return voiceBudget.getMaxLive();
+    }
+
+    /** Returns how many sources currently have a live NVAR source **/
+    int getLiveSourceCount() {
+        return liveSources;
+    }
+
+    /** Scores every source by gain, occlusion and distance to the listener
+     *  and keeps only the most audible ones live. Virtual sources keep their
+     *  id and settings, and their input is consumed and discarded, so they
+     *  resume in step when they become live again. Call once per frame.
+     *  Returns the number of sources that changed state.
+     */
+    int updateSourceBudget() {
+        nvarStatus_t nvarStatus;
+        nvarFloat3_t listener;
+
+        nvarStatus = nvarGetListenerLocation(nvar, &listener);
+        if (nvarStatus != NVAR_STATUS_SUCCESS) {
+            printError(nvarStatus, __FUNCTION__, __LINE__);
+            return 0;
+        }
+        // sources parked on earlier frames, without waiting on the audio thread
+        releaseParkedSources();
+        voiceBudget.plan(sources, listener, budgetPark, budgetRealize);
+
+        int changed = 0;
+        for (size_t i = 0; i < budgetPark.size(); i++) {
+            nvarStatus = parkSource(*sources.get(budgetPark[i]));
+            if (nvarStatus == NVAR_STATUS_SUCCESS) {
+                changed++;
+            } else {
+                printError(nvarStatus, __FUNCTION__, __LINE__);
+            }
+        }
+        for (size_t i = 0; i < budgetRealize.size(); i++) {
+            nvarStatus = realizeSource(*sources.get(budgetRealize[i]));
+            if (nvarStatus == NVAR_STATUS_SUCCESS) {
+                changed++;
+            } else {
+                printError(nvarStatus, __FUNCTION__, __LINE__);
+            }
+        }
+        if (audioRenderer.isRunning()) {
+            updateSourceLods();
+        }
+        updateSourceEffects();
+        return changed;
+    }
+
+    /** Sets how many milliseconds a trace may take. update_source_budget
+     *  measures every trace and, when they run long, lowers the effect preset
+     *  of the least audible sources first, raising them again as time frees
+     *  up. No source goes above the preset it was given. 0 (the default)
+     *  disables it.
+     */
+    void setTraceBudget(float milliseconds) {
+        if (milliseconds < 0.0f) {
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return;
+        }
+        effectBudget.setBudget(milliseconds);
+    }
+
+    /** Returns the trace budget in milliseconds **/
+    float getTraceBudget() {
+        return effectBudget.getBudget();
+    }
+
+    /** Returns the smoothed time NVAR spent on recent traces, in milliseconds **/
+    float getTraceMilliseconds() {
+        return (float)effectBudget.getTraceMilliseconds();
+    }
+
+    /** Sets the highest effect preset a source traces with **/
+    void setSourceEffectPreset(int64_t id, int effect) {
+        SourceState* source = sources.get(id);
+        if (!source || effect < NVAR_EFFECT_LOW || effect > NVAR_EFFECT_PRO) { // No source with this id exists.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return;
+        }
+        source->effect = static_cast<nvarEffect_t>(effect);
+        effectBudget.invalidate();
+        updateSourceEffects();
+    }
+
+    /** Returns the effect preset a source currently traces with, which the
+     *  trace budget may have lowered.
+     */
+    Variant getSourceEffectPreset(int64_t id) {
+        SourceState* source = sources.get(id);
+        if (!source) { // No source with this id exists.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return Variant();
+        }
+        return Variant((int)source->appliedEffect);
+    }
+
+    /** Hands every live source the effect preset the trace budget allows **/
+    void updateSourceEffects() {
+        nvarStatus_t nvarStatus;
+
+        if (!effectBudget.plan(sources, traceScheduler.getNextTraceNumber())) {
+            return;
+        }
+        for (int i = 0; i < sources.size(); i++) {
+            SourceState& state = sources.at(i);
+            if (!state.isLive()) {
+                continue;
+            }
+            nvarStatus = nvarSetSourceEffectPreset(state.handle, state.appliedEffect);
+            if (nvarStatus == NVAR_STATUS_SUCCESS) {
+                // Success
+            } else {
+                printError(nvarStatus, __FUNCTION__, __LINE__);
+            }
+        }
+    }
+
+    /** Sets the share of each audio block period the audio thread may spend
+     *  rendering sources. update_source_budget then renders the most audible
+     *  sources in full, the next ones with their direct path only, and the
+     *  rest with a plain pan, gain and low-pass from their occlusion, based
+     *  on the measured cost of each. 0 (the default) renders every source in full.
+     */
+    void setAudioCpuBudget(float fraction) {
+        if (fraction < 0.0f) {
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return;
+        }
+        lodPlanner.setBudget(fraction);
+    }
+
+    /** Returns the audio CPU budget as a share of the block period **/
+    float getAudioCpuBudget() {
+        return lodPlanner.getBudget();
+    }
+
+    /** Returns the level of detail of a source: 0 full, 1 direct path only,
+     *  2 panned without NVAR filtering.
+     */
+    Variant getSourceLod(int64_t id) {
+        SourceState* source = sources.get(id);
+        if (!source) { // No source with this id exists.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return Variant();
+        }
+        return Variant(source->lod);
+    }
+
+    /** Returns the measured audio thread time per source block at each level
+     *  of detail, in microseconds: full, direct and panned.
+     */
+    Dictionary getAudioLodCosts() {
+        Dictionary result;
+        result["full"] = lodPlanner.getCost(AudioRenderer::LOD_FULL) / 1000.0;
+        result["direct"] = lodPlanner.getCost(AudioRenderer::LOD_DIRECT) / 1000.0;
+        result["panned"] = lodPlanner.getCost(AudioRenderer::LOD_PANNED) / 1000.0;
+        return result;
+    }
+
+    /** Measures the audio thread and hands every live source the level of
+     *  detail the CPU budget allows, with fresh pan settings for panned ones.
+     */
+    void updateSourceLods() {
+        int sampleRate = audioRenderer.getSampleRate();
+        lodPlanner.measure(audioRenderer);
+        lodPlanner.plan(sources, 1e9 * audioRenderer.getBlockSize() / sampleRate);
+        for (int i = 0; i < sources.size(); i++) {
+            SourceState& state = sources.at(i);
+            if (!state.isLive()) {
+                continue;
+            }
+            AudioRenderer::PanSettings pan = { 0.0f, 0.0f, 1.0f };
+            if (state.lod == AudioRenderer::LOD_PANNED) {
+                pan = LodPlanner::panSettings(state, sampleRate);
+            }
+            audioRenderer.setSourceLod(state.handle, (AudioRenderer::SourceLod)state.lod, pan);
+        }
+    }
+
+    /** Returns true if the source has a live NVAR source **/
+    Variant isSourceLive(int64_t id) {
+        SourceState* source = sources.get(id);
+        if (!source) { // No source with this id exists.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return Variant();
+        }
+        return Variant(source->isLive());
+    }
+
+    /** Returns the audibility score from the last update_source_budget **/
+    Variant getSourceScore(int64_t id) {
+        SourceState* source = sources.get(id);
+        if (!source) { // No source with this id exists.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return Variant();
+        }
+        return Variant(source->score);
+    }
+
+    /** Returns how many input samples the source has taken, counting
+     *  samples discarded in real time while it was virtual.
+     */
+    Variant getSourcePlaybackPosition(int64_t id) {
+        SourceState* source = sources.get(id);
+        if (!source) { // No source with this id exists.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return Variant();
+        }
+        if (!source->isLive()) {
+            source->consumeVirtual(audioRenderer.getRenderedFrames());
+        }
+        return Variant(source->position);
+    }
+
+    /** Creates the NVAR source for a virtual source and restores its settings **/
+    nvarStatus_t realizeSource(SourceState& state) {
+        nvarStatus_t nvarStatus;
+
+        nvarStatus = nvarCreateSource(nvar, state.appliedEffect, &state.handle);
+        if (nvarStatus != NVAR_STATUS_SUCCESS) {
+            state.handle = NULL;
+            return nvarStatus;
+        }
+        liveSources++;
+        nvarSetSourceLocation(state.handle, state.location);
+        nvarSetSourceDirectPathGain(state.handle, state.directGain);
+        nvarSetSourceIndirectPathGain(state.handle, state.indirectGain);
+        if (audioRenderer.isRunning()) {
+            attachSourceAudio(state.handle);
+        }
+        return NVAR_STATUS_SUCCESS;
+    }
+
+    /** Destroys the NVAR source of a live source, keeping its settings **/
+    nvarStatus_t parkSource(SourceState& state) {
+        nvarStatus_t nvarStatus = NVAR_STATUS_SUCCESS;
+
+        if (audioRenderer.isAttached(state.handle)) {
+            // the audio thread may still be filtering it, releaseParkedSources destroys it later
+            audioRenderer.detach(state.handle);
+        } else {
+            nvarStatus = nvarDestroySource(state.handle);
+        }
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            state.handle = NULL;
+            state.virtualClock = audioRenderer.getRenderedFrames();
+            state.virtualQueued = 0;
+            state.lod = AudioRenderer::LOD_FULL;
+            liveSources--;
+        }
+        return nvarStatus;
+    }
+
+    /** Destroys the NVAR sources of parked sources the audio thread has let go of **/
+    void releaseParkedSources() {
+        nvarStatus_t nvarStatus;
+
+        audioRenderer.takeReleased(releasedSources);
+        for (size_t i = 0; i < releasedSources.size(); i++) {
+            nvarStatus = nvarDestroySource(releasedSources[i]);
+            if (nvarStatus != NVAR_STATUS_SUCCESS) {
+                printError(nvarStatus, __FUNCTION__, __LINE__);
+            }
+        }
+        releasedSources.clear();
+    }
+
+    nvarStatus_t applyListenerLocation(const nvarFloat3_t& location) {
+        nvarStatus_t nvarStatus = nvarSetListenerLocation(nvar, location);
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            listener.location = location;
+            listener.hasLocation = true;
+        }
+        return nvarStatus;
+    }
+
+    nvarStatus_t applyListenerOrientation(const nvarFloat3_t& forward, const nvarFloat3_t& up) {
+        nvarStatus_t nvarStatus = nvarSetListenerOrientation(nvar, forward, up);
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            listener.forward = forward;
+            listener.up = up;
+            listener.hasOrientation = true;
+        }
+        return nvarStatus;
+    }
+
+    nvarStatus_t applySourceLocation(int64_t id, const nvarFloat3_t& location) {
+        SourceState* source = sources.get(id);
+        if (!source) {
+            return NVAR_STATUS_INVALID_VALUE;
+        }
+        source->location = location;
+        return source->isLive() ? nvarSetSourceLocation(source->handle, location) : NVAR_STATUS_SUCCESS;
+    }
+
+    nvarStatus_t applySourceGain(int64_t id, float gain, bool direct) {
+        SourceState* source = sources.get(id);
+        if (!source) {
+            return NVAR_STATUS_INVALID_VALUE;
+        }
+        (direct ? source->directGain : source->indirectGain) = gain;
+        if (!source->isLive()) {
+            return NVAR_STATUS_SUCCESS;
+        }
+        return direct ? nvarSetSourceDirectPathGain(source->handle, gain) : nvarSetSourceIndirectPathGain(source->handle, gain);
+    }
+
+    /** Returns the id of the source created with the given name **/
+    Variant findSource(godot::String name) {
+        if (!sourceNames.has(name)) { // No source with this name exists.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return Variant();
+        }
+        return Variant(sourceNames.find(name));
+    }
+
+    /** Starts rendering all sources on a dedicated audio thread in blocks of
+     *  blockSize samples at the context's sample rate. bufferLength is the
+     *  length in seconds of the input and output FIFOs.
+     */
+    void startAudio(int blockSize, float bufferLength) {
+        nvarStatus_t nvarStatus;
+        int sampleRate;
+        int filterArraySize = 0;
+        if (blockSize <= 0) {
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return;
+        }
+
+        nvarStatus = nvarGetSampleRate(nvar, &sampleRate);
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            nvarStatus = nvarGetSourceFilterArraySize(nvar, &filterArraySize);
+        }
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            if (AudioRenderer::isConvolverMode(audioRenderer.getMixMode()) && (blockSize < 32 || (blockSize & (blockSize - 1)) != 0)) {
+                // the convolver needs a power of two block size, mix with NVAR instead
+                printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+                audioRenderer.setMixMode(AudioRenderer::MIX_BATCHED);
+            }
+            int filterLength = filterArraySize / (int)sizeof(float) / AudioRenderer::kChannels;
+            audioRenderer.start(nvar, blockSize, sampleRate, bufferLength, filterLength);
+            audioBufferLength = bufferLength;
+            lodPlanner.reset();
+            for (int i = 0; i < sources.size(); i++) {
+                if (sources.at(i).isLive()) {
+                    sources.at(i).lod = AudioRenderer::LOD_FULL;
+                    attachSourceAudio(sources.at(i).handle);
+                }
+            }
+        } else {
+            printError(nvarStatus, __FUNCTION__, __LINE__);
+        }
+    }
+
+    /** Stops the audio thread **/
+    void stopAudio() {
+        audioRenderer.stop();
+        releaseParkedSources();
+        applyDeferredSettings();
+    }
+
+    /** Queues mono samples for a source. Returns the number of samples accepted. **/
+    int pushSourceAudio(int64_t id, PoolRealArray samples) {
+        SourceState* source = sources.get(id);
+        if (!source || !audioRenderer.isRunning()) { // No source with this id exists.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return 0;
+        }
+        if (!source->isLive()) {
+            source->consumeVirtual(audioRenderer.getRenderedFrames());
+            int accepted = std::min(samples.size(), audioRenderer.getInputCapacity() - source->virtualQueued);
+            source->virtualQueued += accepted;
+            return accepted;
+        }
+        PoolRealArray::Read read = samples.read();
+        int accepted = audioRenderer.pushInput(source->handle, read.ptr(), samples.size());
+        source->position += accepted;
+        return accepted;
+    }
+
+    /** Returns how many samples push_source_audio can currently accept for a source **/
+    int getSourceAudioSpace(int64_t id) {
+        SourceState* source = sources.get(id);
+        if (!source) { // No source with this id exists.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return 0;
+        }
+        if (!source->isLive()) {
+            // virtual sources take input at the rate live ones would
+            source->consumeVirtual(audioRenderer.getRenderedFrames());
+            return audioRenderer.getInputCapacity() - source->virtualQueued;
+        }
+        return audioRenderer.getInputSpace(source->handle);
+    }
+
+    /** Moves rendered stereo frames into an AudioStreamGenerator's playback.
+     *  Call every frame. Returns the number of frames pushed.
+     */
+    int mixAudio(Ref<AudioStreamGeneratorPlayback> playback) {
+        if (playback.is_null()) {
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return 0;
+        }
+        int frames = std::min((int)playback->get_frames_available(), audioRenderer.getFramesAvailable());
+        if (frames <= 0) {
+            return 0;
+        }
+
+        static_assert(sizeof(Vector2) == 2 * sizeof(float), "Vector2 is expected to be an interleaved stereo frame");
+        mixFrames.resize(frames);
+        {
+            PoolVector2Array::Write write = mixFrames.write();
+            frames = audioRenderer.pull(reinterpret_cast<float*>(write.ptr()), frames);
+        }
+        mixFrames.resize(frames);
+        playback->push_buffer(mixFrames);
+        return frames;
+    }
+
+    /** Chooses how sources are filtered: 0 filters every source separately with
+     *  nvarApplySourceFilters, 1 (the default) mixes the indirect paths of all
+     *  sources in one batched NVAR call, and 2 convolves the filters from
+     *  nvarGetSourceFilters in the wrapper after every trace. Mode 3 does the
+     *  same with a non-uniformly partitioned convolver, which keeps long
+     *  reverb tails cheap by filtering them in large partitions on a worker
+     *  thread. Modes 2 and 3 need a power of two block size of at least 32
+     *  and can only be entered or left while audio is stopped.
+     */
+    void setAudioMixMode(int mode) {
+        if (mode < AudioRenderer::MIX_PER_SOURCE || mode > AudioRenderer::MIX_CONVOLVER_NONUNIFORM ||
+            !audioRenderer.setMixMode((AudioRenderer::MixMode)mode)) {
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+        }
+    }
+
+    /** Returns the current audio mix mode **/
+    int getAudioMixMode() {
+        return audioRenderer.getMixMode();
+    }
+
+    /** Returns how many blocks were rendered with partial source input **/
+    int getAudioUnderruns() {
+        return audioRenderer.getUnderruns();
+    }
+
+    /** Sets the dB floor at which the convolver modes truncate each filter:
+     *  taps after the point where the remaining energy falls this far below
+     *  the total are dropped. 0 keeps the full reverb length. Default -60.
+     */
+    void setFilterTruncationFloor(float floorDb) {
+        audioRenderer.setTruncationFloor(floorDb);
+    }
+
+    /** Returns the filter truncation floor in dB **/
+    float getFilterTruncationFloor() {
+        return audioRenderer.getTruncationFloor();
+    }
+
+    /** Sets how many seconds at the start of each filter the convolver modes
+     *  search for sparse early reflections. Those are rendered as a multi-tap
+     *  delay line and only the dense rest is convolved. 0 disables the search.
+     *  Default 0.08. Takes effect on the next start_audio.
+     */
+    void setEarlyReflectionWindow(float seconds) {
+        audioRenderer.setEarlyWindow(seconds);
+    }
+
+    /** Returns the early reflection window in seconds **/
+    float getEarlyReflectionWindow() {
+        return audioRenderer.getEarlyWindow();
+    }
+
+    /** Returns the filter lengths of a source rendered in a convolver mode:
+     *  full_length and length in samples per channel before and after
+     *  truncation, builds, the number of filter sets built so far, taps, the
+     *  early reflections rendered as delay taps, and tap_length, the samples
+     *  per channel they cover.
+     */
+    Variant getSourceFilterStats(int64_t id) {
+        AudioRenderer::FilterStats stats;
+        SourceState* source = sources.get(id);
+        if (!source || !source->isLive() || !audioRenderer.getFilterStats(source->handle, stats)) { // No playing source with this id exists.
+            printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+            return Variant();
+        }
+        Dictionary result;
+        result["full_length"] = stats.fullLength;
+        result["length"] = stats.length;
+        result["builds"] = stats.builds;
+        result["taps"] = stats.taps;
+        result["tap_length"] = stats.tapLength;
+        return Variant(result);
+    }
+
+    void attachSourceAudio(nvarSource_t source) {
+        nvarStatus_t nvarStatus;
+
+        nvarStatus = audioRenderer.attach(source);
+        if (nvarStatus == NVAR_STATUS_SUCCESS) {
+            // Success
+        } else {
+            printError(nvarStatus, __FUNCTION__, __LINE__);
+        }
+    }
+
+    /** Executes a packed stream of commands built by NVARCommandBuffer.gd in a
+     *  single call, without creating any Variants. Stops at the first malformed
+     *  command. Returns the number of commands executed.
+     */
+    int submitCommands(PoolByteArray commands) {
+        nvarStatus_t nvarStatus;
+        PoolByteArray::Read read = commands.read();
+        CommandReader reader(read.ptr(), commands.size());
+        int executed = 0;
+
+        while (!reader.atEnd()) {
+            uint8_t op;
+            int64_t id;
+            float value;
+            nvarFloat3_t first;
+            nvarFloat3_t second;
+            nvarMatrix4x4_t transform;
+            bool valid;
+            reader.readOp(op);
+
+            nvarStatus = NVAR_STATUS_SUCCESS;
+            switch (op) {
+                case COMMAND_SET_LISTENER_LOCATION:
+                    valid = reader.readFloat3(first);
+                    if (valid) {
+                        nvarStatus = applyListenerLocation(first);
+                    }
+                    break;
+                case COMMAND_SET_LISTENER_ORIENTATION:
+                    valid = reader.readFloat3(first) && reader.readFloat3(second);
+                    if (valid) {
+                        nvarStatus = applyListenerOrientation(first, second);
+                    }
+                    break;
+                case COMMAND_SET_SOURCE_LOCATION:
+                    valid = reader.readID(id) && reader.readFloat3(first);
+                    if (valid) {
+                        nvarStatus = applySourceLocation(id, first);
+                    }
+                    break;
+                case COMMAND_SET_SOURCE_DIRECT_GAIN:
+                    valid = reader.readID(id) && reader.readFloat(value);
+                    if (valid) {
+                        nvarStatus = applySourceGain(id, value, true);
+                    }
+                    break;
+                case COMMAND_SET_SOURCE_INDIRECT_GAIN:
+                    valid = reader.readID(id) && reader.readFloat(value);
+                    if (valid) {
+                        nvarStatus = applySourceGain(id, value, false);
+                    }
+                    break;
+                case COMMAND_SET_MESH_TRANSFORM:
+                    valid = reader.readID(id) && reader.readTransform(transform);
+                    if (valid) {
+                        nvarStatus = applyMeshTransform(id, transform);
+                    }
+                    break;
+                case COMMAND_SET_MATERIAL_REFLECTION:
+                    valid = reader.readID(id) && reader.readFloat(value);
+                    if (valid) {
+                        nvarStatus = applyMaterialCoefficient(id, value, true);
+                    }
+                    break;
+                case COMMAND_SET_MATERIAL_TRANSMISSION:
+                    valid = reader.readID(id) && reader.readFloat(value);
+                    if (valid) {
+                        nvarStatus = applyMaterialCoefficient(id, value, false);
+                    }
+                    break;
+                case COMMAND_COMMIT_GEOMETRY:
+                    valid = true;
+                    nvarStatus = commitDirtyGeometry();
+                    break;
+                case COMMAND_TRACE:
+                    valid = true;
+                    traceAudio();
+                    break;
+                default:
+                    valid = false;
+                    break;
+            }
+
+            if (!valid) { // Unknown opcode or truncated arguments.
+                printError(NVAR_STATUS_INVALID_VALUE,  __FUNCTION__, __LINE__);
+                break;
+            }
+            if (nvarStatus == NVAR_STATUS_SUCCESS) {
+                // Success
+            } else {
+                printError(nvarStatus, __FUNCTION__, __LINE__);
+            }
+            executed++;
+        }
+        return executed;
+    }
+
+    /** Register methods, members, and signals to expose them to Godot **/
+    static void _register_methods() {
+        register_method("get_version", &GodotNVAR::getVersion);
+        register_method("initialize", &GodotNVAR::initialize);
+        register_method("finalize", &GodotNVAR::finalize);
+        register_method("get_initialize_flags", &GodotNVAR::getInitializeFlags);
+        register_method("get_device_count", &GodotNVAR::getDeviceCount);
+        register_method("get_device_name", &GodotNVAR::getDeviceName);
+        register_method("get_preferred_device", &GodotNVAR::getPreferredDevice);
+        register_method("create", &GodotNVAR::create);
+        register_method("create_async", &GodotNVAR::createAsync);
+        register_method("_on_context_ready", &GodotNVAR::_on_context_ready);
+        register_method("calibrate", &GodotNVAR::calibrate);
+        register_method("create_calibrated", &GodotNVAR::createCalibrated);
+        register_method("destroy", &GodotNVAR::destroy);
+        register_method("rebuild", &GodotNVAR::rebuild);
+        register_method("get_device_num", &GodotNVAR::getDeviceNum);
+        register_method("get_reverb_length", &GodotNVAR::getReverbLength);
         register_method("set_reverb_length", &GodotNVAR::setReverbLength);
         register_method("get_sample_rate", &GodotNVAR::getSampleRate);
         register_method("set_sample_rate", &GodotNVAR::setSampleRate);
@@ -728,7 +2563,10 @@ public:
         register_method("set_decay_factor", &GodotNVAR::setDecayFactor);
         register_method("get_unit_length", &GodotNVAR::getUnitLength);
         register_method("set_unit_length", &GodotNVAR::setUnitLength);
+        register_method("configure", &GodotNVAR::configure);
+        register_method("get_deferred_configuration", &GodotNVAR::getDeferredConfiguration);
         register_method("commit_geometry", &GodotNVAR::commitGeometry);
+        register_method("get_geometry_commit_stats", &GodotNVAR::getGeometryCommitStats);
         register_method("export_objs", &GodotNVAR::exportOBJs);
         register_method("get_listener_location", &GodotNVAR::getListenerLocation);
         register_method("set_listener_location", &GodotNVAR::setListenerLocation);
@@ -736,18 +2574,73 @@ public:
         register_method("get_listener_up_axis", &GodotNVAR::getlistenerUpAxis);
         register_method("set_listener_orientation", &GodotNVAR::setListenerOrientation);
         register_method("trace_audio", &GodotNVAR::traceAudio);
+        register_method("_flush_traces", &GodotNVAR::_flush_traces);
+        register_method("_on_trace_completed", &GodotNVAR::_on_trace_completed);
+        register_method("set_max_traces_in_flight", &GodotNVAR::setMaxTracesInFlight);
+        register_method("get_max_traces_in_flight", &GodotNVAR::getMaxTracesInFlight);
+        register_method("get_traces_in_flight", &GodotNVAR::getTracesInFlight);
         register_method("synchronize", &GodotNVAR::synchronize);
         register_method("create_material", &GodotNVAR::createMaterial);
         register_method("create_predefined_material", &GodotNVAR::createPredefinedMaterial);
         register_method("destroy_material", &GodotNVAR::destroyMaterial);
         register_method("get_material_ids", &GodotNVAR::getMaterialIDs);
+        register_method("find_material", &GodotNVAR::findMaterial);
         register_method("get_material_reflection", &GodotNVAR::getMaterialReflection);
         register_method("set_material_reflection", &GodotNVAR::setMaterialReflection);
         register_method("get_material_transmission", &GodotNVAR::getMaterialTransmission);
         register_method("set_material_transmission", &GodotNVAR::setMaterialTransmission);
         register_method("create_mesh", &GodotNVAR::createMesh);
         register_method("destroy_mesh", &GodotNVAR::destroyMesh);
+        register_method("find_mesh", &GodotNVAR::findMesh);
+        register_method("_on_mesh_changed", &GodotNVAR::_on_mesh_changed);
+        register_method("get_geometry_cache_stats", &GodotNVAR::getGeometryCacheStats);
+        register_method("set_mesh_transform", &GodotNVAR::setMeshTransform);
+        register_method("set_mesh_transforms", &GodotNVAR::setMeshTransforms);
+        register_method("set_mesh_transform_epsilon", &GodotNVAR::setMeshTransformEpsilon);
+        register_method("get_mesh_transform_epsilon", &GodotNVAR::getMeshTransformEpsilon);
+        register_method("get_mesh_transform_stats", &GodotNVAR::getMeshTransformStats);
+        register_method("create_meshes", &GodotNVAR::createMeshes);
+        register_method("import_multimesh", &GodotNVAR::importMultiMesh);
+        register_method("import_gridmap", &GodotNVAR::importGridMap);
+        register_method("begin_geometry_batch", &GodotNVAR::beginGeometryBatch);
+        register_method("end_geometry_batch", &GodotNVAR::endGeometryBatch);
         register_method("create_source", &GodotNVAR::createSource);
+        register_method("destroy_source", &GodotNVAR::destroySource);
+        register_method("find_source", &GodotNVAR::findSource);
+        register_method("set_source_location", &GodotNVAR::setSourceLocation);
+        register_method("set_source_direct_gain", &GodotNVAR::setSourceDirectGain);
+        register_method("set_source_indirect_gain", &GodotNVAR::setSourceIndirectGain);
+        register_method("set_source_priority", &GodotNVAR::setSourcePriority);
+        register_method("set_max_live_sources", &GodotNVAR::setMaxLiveSources);
+        register_method("get_max_live_sources", &GodotNVAR::getMaxLiveSources);
+        register_method("get_live_source_count", &GodotNVAR::getLiveSourceCount);
+        register_method("update_source_budget", &GodotNVAR::updateSourceBudget);
+        register_method("is_source_live", &GodotNVAR::isSourceLive);
+        register_method("get_source_score", &GodotNVAR::getSourceScore);
+        register_method("get_source_playback_position", &GodotNVAR::getSourcePlaybackPosition);
+        register_method("set_audio_cpu_budget", &GodotNVAR::setAudioCpuBudget);
+        register_method("get_audio_cpu_budget", &GodotNVAR::getAudioCpuBudget);
+        register_method("get_source_lod", &GodotNVAR::getSourceLod);
+        register_method("get_audio_lod_costs", &GodotNVAR::getAudioLodCosts);
+        register_method("set_trace_budget", &GodotNVAR::setTraceBudget);
+        register_method("get_trace_budget", &GodotNVAR::getTraceBudget);
+        register_method("get_trace_milliseconds", &GodotNVAR::getTraceMilliseconds);
+        register_method("set_source_effect_preset", &GodotNVAR::setSourceEffectPreset);
+        register_method("get_source_effect_preset", &GodotNVAR::getSourceEffectPreset);
+        register_method("submit_commands", &GodotNVAR::submitCommands);
+        register_method("start_audio", &GodotNVAR::startAudio);
+        register_method("stop_audio", &GodotNVAR::stopAudio);
+        register_method("push_source_audio", &GodotNVAR::pushSourceAudio);
+        register_method("get_source_audio_space", &GodotNVAR::getSourceAudioSpace);
+        register_method("mix_audio", &GodotNVAR::mixAudio);
+        register_method("get_audio_underruns", &GodotNVAR::getAudioUnderruns);
+        register_method("set_filter_truncation_floor", &GodotNVAR::setFilterTruncationFloor);
+        register_method("get_filter_truncation_floor", &GodotNVAR::getFilterTruncationFloor);
+        register_method("get_source_filter_stats", &GodotNVAR::getSourceFilterStats);
+        register_method("set_early_reflection_window", &GodotNVAR::setEarlyReflectionWindow);
+        register_method("get_early_reflection_window", &GodotNVAR::getEarlyReflectionWindow);
+        register_method("set_audio_mix_mode", &GodotNVAR::setAudioMixMode);
+        register_method("get_audio_mix_mode", &GodotNVAR::getAudioMixMode);
 
         /**
          * The line below is equivalent to the following GDScript export:
@@ -761,6 +2654,8 @@ public:
         /** Registering a signal: **/
         // register_signal<GodotNVAR>("signal_name");
         // register_signal<GodotNVAR>("signal_name", "string_argument", GODOT_VARIANT_TYPE_STRING)
+        register_signal<GodotNVAR>("trace_completed", "trace_number", GODOT_VARIANT_TYPE_INT);
+        register_signal<GodotNVAR>("context_ready", "success", GODOT_VARIANT_TYPE_BOOL);
     }
 
     String _name;
@@ -774,12 +2669,65 @@ public:
         return _value;
     }
 
-    nvar_t nvar;
+    /** Where calibrate keeps its results between launches **/
+    static constexpr const char* kCalibrationPath = "user://godotnvar_calibration.cfg";
+
+    nvar_t nvar = NULL;            // NULL while no context exists
     const char* contextName = "GodotNVAR";
 
-    std::map<godot::String, nvarMaterial_t*> materials;
-    std::map<godot::String, nvarMesh_t*> meshes;
-    std::map<godot::String, nvarSource_t*> sources;
+    HandleTable<MaterialState> materials;
+    HandleTable<MeshState> meshes;
+    HandleTable<SourceState> sources;
+    HandleNames materialNames;
+    HandleNames meshNames;
+    HandleNames sourceNames;
+    MeshBuilder meshBuilder;       // reused so its buffers keep their capacity
+    GeometryCache geometryCache;
+    int geometryBatchDepth = 0;
+    std::vector<int64_t> batchMeshes;              // meshes waiting for end_geometry_batch
+    std::vector<float> importColumns;              // instance transforms as basis axes and origin
+    std::vector<int> importItems;                  // index into importMeshes of each instance
+    std::vector<Ref<Mesh> > importMeshes;
+    std::vector<nvarMatrix4x4_t> importTransforms;
+    float meshTranslationEpsilon = 1e-3f;
+    float meshBasisEpsilon = 1e-3f;
+    int meshTransformsApplied = 0;
+    int meshTransformsSkipped = 0;
+    Dictionary deferredSettings;   // configure settings waiting for the scene to empty
+    Dictionary contextSettings;    // settings applied to the context, replayed by rebuild
+    ListenerState listener;
+    bool contextCreated = false;
+    int contextPreset = 0;
+    int contextDevice = 0;
+
+    std::thread createThread;      // create_async's worker
+    bool creatingAsync = false;
+    ContextSetup asyncSetup;
+    Dictionary asyncSettings;
+    nvar_t asyncNvar = NULL;
+    nvarStatus_t asyncStatus = NVAR_STATUS_SUCCESS;
+
+    bool geometryDirty = false;         // meshes or materials changed since the last commit
+    int64_t geometryCommitFrame = -1;   // idle frame of the last commit
+    int geometryCommits = 0;
+    int geometryCommitsSkipped = 0;
+    int geometryCommitsDeferred = 0;
+
+    TraceScheduler traceScheduler;
+    bool tracePending = false;
+    bool traceFlushQueued = false;
+
+    AudioRenderer audioRenderer;
+    PoolVector2Array mixFrames;
+    float audioBufferLength = 0.0f;
+
+    VoiceBudget voiceBudget;
+    int liveSources = 0;
+    std::vector<int64_t> budgetPark;
+    std::vector<int64_t> budgetRealize;
+    std::vector<nvarSource_t> releasedSources;
+    LodPlanner lodPlanner;
+    EffectBudget effectBudget;
 };
 
 /** GDNative Initialize **/
@@ -0,0 +1,168 @@
+#ifndef GODOTNVAR_HANDLE_TABLE_H
+#define GODOTNVAR_HANDLE_TABLE_H
+
+#include <Godot.hpp>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+/** Slot map storing values contiguously behind generational integer IDs.
+ *  An ID packs the slot generation in the high 32 bits and the slot index
+ *  in the low 32 bits; 0 is never a valid ID. Lookups are O(1), stale IDs
+ *  are rejected, and the values can be iterated as one dense array.
+ */
+template <class T>
+class HandleTable {
+public:
+    /** Stores a value and returns its ID **/
+    int64_t insert(const T& value) {
+        uint32_t slot;
+        if (freeSlots.empty()) {
+            slot = (uint32_t)slots.size();
+            Slot s;
+            s.generation = 1;
+            slots.push_back(s);
+        } else {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        slots[slot].dense = (uint32_t)values.size();
+        values.push_back(value);
+        denseToSlot.push_back(slot);
+        return makeID(slot, slots[slot].generation);
+    }
+
+    /** Returns the value for a live ID, or nullptr **/
+    T* get(int64_t id) {
+        uint32_t slot;
+        if (!resolve(id, slot)) {
+            return nullptr;
+        }
+        return &values[slots[slot].dense];
+    }
+
+    const T* get(int64_t id) const {
+        return const_cast<HandleTable*>(this)->get(id);
+    }
+
+    bool contains(int64_t id) const {
+        uint32_t slot;
+        return resolve(id, slot);
+    }
+
+    /** Removes a value, invalidating its ID. Returns false for stale IDs. **/
+    bool erase(int64_t id) {
+        uint32_t slot;
+        if (!resolve(id, slot)) {
+            return false;
+        }
+        uint32_t dense = slots[slot].dense;
+        uint32_t last = (uint32_t)values.size() - 1;
+        if (dense != last) {
+            // keep the values packed by moving the last one into the hole
+            values[dense] = values[last];
+            denseToSlot[dense] = denseToSlot[last];
+            slots[denseToSlot[dense]].dense = dense;
+        }
+        values.pop_back();
+        denseToSlot.pop_back();
+        // generation 0 is skipped so ID 0 stays invalid
+        if (++slots[slot].generation == 0) {
+            slots[slot].generation = 1;
+        }
+        freeSlots.push_back(slot);
+        return true;
+    }
+
+    void clear() {
+        while (!values.empty()) {
+            erase(idAt(size() - 1));
+        }
+    }
+
+    /** Dense storage, for bulk per-frame iteration **/
+    int size() const { return (int)values.size(); }
+    bool empty() const { return values.empty(); }
+    T* data() { return values.data(); }
+    const T* data() const { return values.data(); }
+    T& at(int denseIndex) { return values[denseIndex]; }
+    const T& at(int denseIndex) const { return values[denseIndex]; }
+
+    /** ID of the value at a dense index **/
+    int64_t idAt(int denseIndex) const {
+        uint32_t slot = denseToSlot[denseIndex];
+        return makeID(slot, slots[slot].generation);
+    }
+
+private:
+    struct Slot {
+        uint32_t dense;
+        uint32_t generation;
+    };
+
+    static int64_t makeID(uint32_t slot, uint32_t generation) {
+        return (int64_t)(((uint64_t)generation << 32) | slot);
+    }
+
+    bool resolve(int64_t id, uint32_t& slot) const {
+        uint64_t bits = (uint64_t)id;
+        slot = (uint32_t)(bits & 0xFFFFFFFFu);
+        uint32_t generation = (uint32_t)(bits >> 32);
+        return generation != 0 && slot < slots.size() && slots[slot].generation == generation &&
+               slots[slot].dense < values.size() && denseToSlot[slots[slot].dense] == slot;
+    }
+
+    std::vector<T> values;
+    std::vector<uint32_t> denseToSlot;
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+};
+
+/** Optional name lookup for IDs in a HandleTable **/
+class HandleNames {
+public:
+    /** Binds a name to an ID. Empty names are not indexed. Returns false
+     *  if the name is already taken.
+     */
+    bool bind(const godot::String& name, int64_t id) {
+        if (name.empty()) {
+            return true;
+        }
+        if (byName.count(name) > 0) {
+            return false;
+        }
+        byName[name] = id;
+        byID[id] = name;
+        return true;
+    }
+
+    bool has(const godot::String& name) const {
+        return !name.empty() && byName.count(name) > 0;
+    }
+
+    /** Returns the ID bound to a name, or 0 **/
+    int64_t find(const godot::String& name) const {
+        std::map<godot::String, int64_t>::const_iterator it = byName.find(name);
+        return it == byName.end() ? 0 : it->second;
+    }
+
+    void unbind(int64_t id) {
+        std::unordered_map<int64_t, godot::String>::iterator it = byID.find(id);
+        if (it != byID.end()) {
+            byName.erase(it->second);
+            byID.erase(it);
+        }
+    }
+
+    void clear() {
+        byName.clear();
+        byID.clear();
+    }
+
+private:
+    std::map<godot::String, int64_t> byName;
+    std::unordered_map<int64_t, godot::String> byID;
+};
+
+#endif // GODOTNVAR_HANDLE_TABLE_H
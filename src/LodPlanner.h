@@ -0,0 +1,156 @@
+#ifndef GODOTNVAR_LOD_PLANNER_H
+#define GODOTNVAR_LOD_PLANNER_H
+
+#include "nvar.h"
+#include "nvarNDA.h"
+#include "AudioRenderer.h"
+#include "HandleTable.h"
+#include "VoiceBudget.h"
+#include "dsp/MathConstants.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/** Chooses the level of detail of every live source so the audio thread
+ *  stays within a share of each block period. The cost of a voice block at
+ *  each level is measured on the audio thread; sources are then visited in
+ *  order of their VoiceBudget score and each gets the most detailed level
+ *  the remaining budget pays for. A source only moves up a level when its
+ *  cost fits with some margin, so sources near the cut do not flip.
+ */
+class LodPlanner {
+public:
+    LodPlanner() : budget(0.0f), upgradeMargin(1.2f) {
+        reset();
+    }
+
+    /** Share of the block period the audio thread may spend on sources.
+     *  0 disables level of detail: every live source renders in full.
+     */
+    void setBudget(float fraction) { budget = std::max(fraction, 0.0f); }
+    float getBudget() const { return budget; }
+
+    /** Forgets the measured costs, for a renderer that restarted **/
+    void reset() {
+        for (int lod = 0; lod < AudioRenderer::LOD_COUNT; lod++) {
+            cost[lod] = 0.0;
+            lastNanos[lod] = 0;
+            lastBlocks[lod] = 0;
+        }
+    }
+
+    /** Average nanoseconds per voice block at a level, 0 until measured **/
+    double getCost(int lod) const { return cost[lod]; }
+
+    /** Folds the renderer's timings since the last call into the costs **/
+    void measure(const AudioRenderer& renderer) {
+        int64_t nanos[AudioRenderer::LOD_COUNT];
+        int64_t blocks[AudioRenderer::LOD_COUNT];
+        renderer.getLodCosts(nanos, blocks);
+        for (int lod = 0; lod < AudioRenderer::LOD_COUNT; lod++) {
+            int64_t newBlocks = blocks[lod] - lastBlocks[lod];
+            if (newBlocks < 0) {
+                // the counters belong to a new renderer
+                lastNanos[lod] = 0;
+                lastBlocks[lod] = 0;
+                newBlocks = blocks[lod];
+            }
+            if (newBlocks > 0) {
+                double sample = (double)(nanos[lod] - lastNanos[lod]) / newBlocks;
+                cost[lod] = cost[lod] > 0.0 ? cost[lod] + kSmoothing * (sample - cost[lod]) : sample;
+                lastNanos[lod] = nanos[lod];
+                lastBlocks[lod] = blocks[lod];
+            }
+        }
+    }
+
+    /** Sets state.lod for every live source. blockNanos is the duration of
+     *  one audio block. Scores must be fresh from VoiceBudget::plan.
+     */
+    void plan(HandleTable<SourceState>& sources, double blockNanos) {
+        ranked.clear();
+        for (int i = 0; i < sources.size(); i++) {
+            if (sources.at(i).isLive()) {
+                ranked.push_back(i);
+            }
+        }
+        if (budget <= 0.0f || cost[AudioRenderer::LOD_FULL] <= 0.0) {
+            // nothing to budget against yet, full detail also measures the full cost
+            for (size_t i = 0; i < ranked.size(); i++) {
+                sources.at(ranked[i]).lod = AudioRenderer::LOD_FULL;
+            }
+            return;
+        }
+
+        std::sort(ranked.begin(), ranked.end(), [&sources](int a, int b) {
+            return sources.at(a).score > sources.at(b).score;
+        });
+        double estimate[AudioRenderer::LOD_COUNT];
+        for (int lod = 0; lod < AudioRenderer::LOD_COUNT; lod++) {
+            estimate[lod] = cost[lod] > 0.0 ? cost[lod] : cost[AudioRenderer::LOD_FULL] * priorShare(lod);
+        }
+        double remaining = budget * blockNanos;
+        for (size_t i = 0; i < ranked.size(); i++) {
+            SourceState& state = sources.at(ranked[i]);
+            int lod = AudioRenderer::LOD_FULL;
+            for (; lod < AudioRenderer::LOD_PANNED; lod++) {
+                double needed = estimate[lod] * (lod < state.lod ? upgradeMargin : 1.0f);
+                if (needed <= remaining) {
+                    break;
+                }
+            }
+            state.lod = lod;
+            remaining -= estimate[lod];
+        }
+    }
+
+    /** Pan, gain and low-pass of a LOD_PANNED source from its direct path:
+     *  occlusion and distance attenuation from nvarGetSourceOcclusionSettings
+     *  scale the gain, occlusion also closes the low-pass, and the azimuth
+     *  from nvarGetSourceDetails pans with a constant power law.
+     */
+    static AudioRenderer::PanSettings panSettings(const SourceState& state, int sampleRate) {
+        AudioRenderer::PanSettings pan;
+        float occlusion = 1.0f;
+        float distance = 1.0f;
+        float azimuth = 0.0f;
+        nvarSourceDetails_t details;
+        nvarGetSourceOcclusionSettings(state.handle, &occlusion, &distance);
+        if (nvarGetSourceDetails(state.handle, &details) == NVAR_STATUS_SUCCESS) {
+            azimuth = details.azimuth;
+        }
+        occlusion = std::min(std::max(occlusion, 0.0f), 1.0f);
+        float gain = state.directGain * occlusion * distance;
+        float side = std::sin(azimuth * (float)dsp::kPi / 180.0f);   // -1 left to 1 right
+        float angle = (side + 1.0f) * (float)dsp::kPi / 4.0f;
+        pan.left = gain * std::cos(angle);
+        pan.right = gain * std::sin(angle);
+
+        float cutoff = kOpenCutoff * std::pow(kOccludedCutoff / kOpenCutoff, 1.0f - occlusion);
+        pan.lowpass = std::min(1.0f, 1.0f - std::exp(-2.0f * (float)dsp::kPi * cutoff / sampleRate));
+        return pan;
+    }
+
+private:
+    /** Weight of each new measurement in the running cost **/
+    static constexpr double kSmoothing = 0.25;
+    /** Low-pass cutoff of an unoccluded and a fully occluded source, in Hz **/
+    static constexpr float kOpenCutoff = 20000.0f;
+    static constexpr float kOccludedCutoff = 400.0f;
+
+    /** Assumed cost of a level relative to LOD_FULL until it is measured **/
+    static double priorShare(int lod) {
+        return lod == AudioRenderer::LOD_PANNED ? 0.02 : lod == AudioRenderer::LOD_DIRECT ? 0.25 : 1.0;
+    }
+
+    float budget;
+    float upgradeMargin;
+    double cost[AudioRenderer::LOD_COUNT];
+    int64_t lastNanos[AudioRenderer::LOD_COUNT];
+    int64_t lastBlocks[AudioRenderer::LOD_COUNT];
+    std::vector<int> ranked;
+};
+
+#endif // GODOTNVAR_LOD_PLANNER_H
@@ -0,0 +1,230 @@
+#ifndef GODOTNVAR_MESH_BUILDER_H
+#define GODOTNVAR_MESH_BUILDER_H
+
+#include <Godot.hpp>
+#include <Mesh.hpp>
+#include <ArrayMesh.hpp>
+#include "nvar.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+static_assert(sizeof(nvarFloat3_t) == 3 * sizeof(float) && offsetof(nvarFloat3_t, y) == sizeof(float) &&
+              offsetof(nvarFloat3_t, z) == 2 * sizeof(float), "nvarFloat3_t is expected to be three packed floats");
+static_assert(sizeof(int) == 4, "PoolIntArray indices are expected to match NVAR's int faces");
+
+/** True when a Godot Vector3 array can be handed to NVAR without conversion **/
+static const bool kVector3MatchesFloat3 = std::is_same<real_t, float>::value &&
+    sizeof(godot::Vector3) == sizeof(nvarFloat3_t) && std::is_standard_layout<godot::Vector3>::value;
+
+/** Collects the triangles of Godot meshes into the shared vertex and
+ *  index buffers nvarCreateMesh expects. A single indexed surface is
+ *  borrowed straight from Godot's pool arrays without copying.
+ */
+class MeshBuilder {
+public:
+    MeshBuilder() : borrowedVertices(nullptr), borrowedFaces(nullptr), numBorrowedVertices(0), numBorrowedIndices(0) { }
+
+    void clear() {
+        releaseBorrowed();
+        vertices.clear();
+        faces.clear();
+    }
+
+    /** Appends every triangle surface of the mesh. Indexed surfaces are passed
+     *  through as is, non-indexed surfaces are welded on exact vertex position.
+     *  Surfaces of other primitives are skipped. Returns false if the mesh had
+     *  no triangles.
+     */
+    bool appendMesh(const godot::Ref<godot::Mesh>& mesh) {
+        int startFaces = getNumFaces();
+        int surfaceCount = (int)mesh->get_surface_count();
+        // only an ArrayMesh can hold anything but triangle lists
+        godot::ArrayMesh* arrayMesh = godot::Object::cast_to<godot::ArrayMesh>(mesh.ptr());
+        for (int s = 0; s < surfaceCount; s++) {
+            if (arrayMesh && arrayMesh->surface_get_primitive_type(s) != godot::Mesh::PRIMITIVE_TRIANGLES) {
+                continue;
+            }
+            godot::Array arrays = mesh->surface_get_arrays(s);
+            if (arrays.size() <= godot::Mesh::ARRAY_INDEX) {
+                continue;
+            }
+            const godot::Variant& vertexArray = arrays[godot::Mesh::ARRAY_VERTEX];
+            const godot::Variant& indexArray = arrays[godot::Mesh::ARRAY_INDEX];
+            if (vertexArray.get_type() != godot::Variant::POOL_VECTOR3_ARRAY) {
+                continue;
+            }
+            if (indexArray.get_type() == godot::Variant::POOL_INT_ARRAY) {
+                appendIndexed(vertexArray, indexArray);
+            } else {
+                appendWelded(vertexArray);
+            }
+        }
+
+        if (getNumFaces() == startFaces) {
+            // Meshes without readable triangle lists, such as strips, can still provide their faces
+            appendWelded(mesh->get_faces());
+        }
+        return getNumFaces() > startFaces;
+    }
+
+    /** Appends a surface with its own index buffer **/
+    void appendIndexed(const godot::PoolVector3Array& gVertices, const godot::PoolIntArray& gIndices) {
+        int numVertices = gVertices.size();
+        int numIndices = gIndices.size();
+        godot::PoolIntArray::Read indices = gIndices.read();
+
+        if (kVector3MatchesFloat3 && isEmpty() && numIndices % 3 == 0 &&
+                indicesInRange(indices.ptr(), numIndices, numVertices)) {
+            // First clean surface: keep the pool arrays locked and point NVAR at them
+            vertexPool = gVertices;
+            indexPool = gIndices;
+            vertexRead = vertexPool.read();
+            indexRead = indexPool.read();
+            borrowedVertices = reinterpret_cast<const nvarFloat3_t*>(vertexRead.ptr());
+            borrowedFaces = indexRead.ptr();
+            numBorrowedVertices = numVertices;
+            numBorrowedIndices = numIndices;
+            return;
+        }
+
+        makeOwned();
+        int base = (int)vertices.size();
+        vertices.resize(base + numVertices);
+        convertVertices(gVertices, &vertices[base], numVertices);
+
+        const int* index = indices.ptr();
+        numIndices -= numIndices % 3;
+        faces.reserve(faces.size() + numIndices);
+        for (int i = 0; i < numIndices; i += 3) {
+            int a = index[i];
+            int b = index[i + 1];
+            int c = index[i + 2];
+            if (a < 0 || b < 0 || c < 0 || a >= numVertices || b >= numVertices || c >= numVertices) {
+                continue;
+            }
+            faces.push_back(base + a);
+            faces.push_back(base + b);
+            faces.push_back(base + c);
+        }
+    }
+
+    /** Appends a triangle list, merging vertices that share a position **/
+    void appendWelded(const godot::PoolVector3Array& gVertices) {
+        makeOwned();
+        int numVertices = gVertices.size() - gVertices.size() % 3;
+        std::vector<nvarFloat3_t> positions(numVertices);
+        convertVertices(gVertices, positions.data(), numVertices);
+
+        std::unordered_map<PositionKey, int, PositionHash> welded;
+        welded.reserve(numVertices / 2);
+        faces.reserve(faces.size() + numVertices);
+        for (int i = 0; i < numVertices; i++) {
+            PositionKey key(positions[i]);
+            std::pair<std::unordered_map<PositionKey, int, PositionHash>::iterator, bool> found =
+                welded.insert(std::make_pair(key, (int)vertices.size()));
+            if (found.second) {
+                vertices.push_back(positions[i]);
+            }
+            faces.push_back(found.first->second);
+        }
+    }
+
+    const nvarFloat3_t* getVertices() const { return borrowedVertices ? borrowedVertices : vertices.data(); }
+    int getNumVertices() const { return borrowedVertices ? numBorrowedVertices : (int)vertices.size(); }
+    const int* getFaces() const { return borrowedFaces ? borrowedFaces : faces.data(); }
+    int getNumFaces() const { return (borrowedFaces ? numBorrowedIndices : (int)faces.size()) / 3; }
+
+    /** True if the faces are a surface borrowed from the pool arrays below **/
+    bool isBorrowed() const { return borrowedVertices != nullptr; }
+    const godot::PoolVector3Array& getVertexPool() const { return vertexPool; }
+    const godot::PoolIntArray& getIndexPool() const { return indexPool; }
+
+private:
+    /** Bitwise vertex position, so welding only merges exact duplicates **/
+    struct PositionKey {
+        uint32_t bits[3];
+
+        explicit PositionKey(const nvarFloat3_t& p) {
+            std::memcpy(&bits[0], &p.x, sizeof(float));
+            std::memcpy(&bits[1], &p.y, sizeof(float));
+            std::memcpy(&bits[2], &p.z, sizeof(float));
+        }
+        bool operator==(const PositionKey& other) const {
+            return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+        }
+    };
+
+    struct PositionHash {
+        size_t operator()(const PositionKey& key) const {
+            uint64_t h = key.bits[0] * 0x9E3779B1u;
+            h = (h ^ key.bits[1]) * 0x85EBCA77u;
+            h = (h ^ key.bits[2]) * 0xC2B2AE3Du;
+            return (size_t)(h ^ (h >> 29));
+        }
+    };
+
+    static bool indicesInRange(const int* index, int numIndices, int numVertices) {
+        unsigned limit = (unsigned)numVertices;
+        unsigned bad = 0;
+        for (int i = 0; i < numIndices; i++) {
+            bad |= (unsigned)(index[i]) >= limit;
+        }
+        return bad == 0;
+    }
+
+    /** Copies vertex positions under a single read lock **/
+    static void convertVertices(const godot::PoolVector3Array& gVertices, nvarFloat3_t* out, int count) {
+        godot::PoolVector3Array::Read read = gVertices.read();
+        const godot::Vector3* in = read.ptr();
+        if (kVector3MatchesFloat3) {
+            std::memcpy(out, in, (size_t)count * sizeof(nvarFloat3_t));
+            return;
+        }
+        for (int i = 0; i < count; i++) {
+            out[i].x = (float)in[i].x;
+            out[i].y = (float)in[i].y;
+            out[i].z = (float)in[i].z;
+        }
+    }
+
+    bool isEmpty() const { return borrowedVertices == nullptr && vertices.empty() && faces.empty(); }
+
+    /** Moves a borrowed surface into the owned buffers before appending more **/
+    void makeOwned() {
+        if (!borrowedVertices) {
+            return;
+        }
+        vertices.assign(borrowedVertices, borrowedVertices + numBorrowedVertices);
+        faces.assign(borrowedFaces, borrowedFaces + numBorrowedIndices);
+        releaseBorrowed();
+    }
+
+    void releaseBorrowed() {
+        vertexRead = godot::PoolVector3Array::Read();
+        indexRead = godot::PoolIntArray::Read();
+        vertexPool = godot::PoolVector3Array();
+        indexPool = godot::PoolIntArray();
+        borrowedVertices = nullptr;
+        borrowedFaces = nullptr;
+        numBorrowedVertices = 0;
+        numBorrowedIndices = 0;
+    }
+
+    std::vector<nvarFloat3_t> vertices;
+    std::vector<int> faces;
+
+    godot::PoolVector3Array vertexPool;
+    godot::PoolIntArray indexPool;
+    godot::PoolVector3Array::Read vertexRead;
+    godot::PoolIntArray::Read indexRead;
+    const nvarFloat3_t* borrowedVertices;
+    const int* borrowedFaces;
+    int numBorrowedVertices;
+    int numBorrowedIndices;
+};
+
+#endif // GODOTNVAR_MESH_BUILDER_H
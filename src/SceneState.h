@@ -0,0 +1,125 @@
+#ifndef GODOTNVAR_SCENE_STATE_H
+#define GODOTNVAR_SCENE_STATE_H
+
+#include "nvar.h"
+#include "MeshBuilder.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+/** Wrapper side state of an acoustic material, enough to create it again
+ *  in a new context.
+ */
+struct MaterialState {
+    nvarMaterial_t handle;
+    int predefined;              // nvarPredefinedMaterial_t it was created from, -1 for a default material
+    float reflection;
+    float transmission;
+
+    MaterialState() : handle(NULL), predefined(-1), reflection(0.0f), transmission(0.0f) { }
+};
+
+/** Vertices and faces of one Godot Mesh as NVAR takes them. Once the
+ *  meshes are created from it the geometry is no longer changed, so every
+ *  acoustic mesh placing the Mesh and rebuilt contexts share one copy,
+ *  which is freed with the last of them.
+ */
+class MeshGeometry {
+public:
+    MeshGeometry() : borrowedVertices(nullptr), borrowedFaces(nullptr), numVertices(0), numFaces(0) { }
+
+    /** Takes the builder's vertices and faces. A surface the builder
+     *  borrowed is kept as the pool arrays themselves rather than copied:
+     *  they are reference counted and copy-on-write, so holding them is
+     *  cheap and a later edit of the Mesh copies them instead of changing
+     *  this geometry.
+     */
+    void assign(const MeshBuilder& builder) {
+        numVertices = builder.getNumVertices();
+        numFaces = builder.getNumFaces();
+        if (builder.isBorrowed()) {
+            vertexPool = builder.getVertexPool();
+            indexPool = builder.getIndexPool();
+            vertexRead = vertexPool.read();
+            indexRead = indexPool.read();
+            borrowedVertices = reinterpret_cast<const nvarFloat3_t*>(vertexRead.ptr());
+            borrowedFaces = indexRead.ptr();
+            return;
+        }
+        vertices.assign(builder.getVertices(), builder.getVertices() + numVertices);
+        faces.assign(builder.getFaces(), builder.getFaces() + numFaces * 3);
+    }
+
+    const nvarFloat3_t* getVertices() const { return borrowedVertices ? borrowedVertices : vertices.data(); }
+    int getNumVertices() const { return numVertices; }
+    const int* getFaces() const { return borrowedFaces ? borrowedFaces : faces.data(); }
+    int getNumFaces() const { return numFaces; }
+
+private:
+    std::vector<nvarFloat3_t> vertices;
+    std::vector<int> faces;
+
+    godot::PoolVector3Array vertexPool;
+    godot::PoolIntArray indexPool;
+    godot::PoolVector3Array::Read vertexRead;
+    godot::PoolIntArray::Read indexRead;
+    const nvarFloat3_t* borrowedVertices;
+    const int* borrowedFaces;
+    int numVertices;
+    int numFaces;
+};
+
+/** Wrapper side state of an acoustic mesh. The converted geometry is kept
+ *  so a new context gets the mesh without going back to the Godot Mesh.
+ */
+struct MeshState {
+    nvarMesh_t handle;
+    nvarMatrix4x4_t transform;
+    int64_t material;            // material id in the wrapper's table
+    std::shared_ptr<const MeshGeometry> geometry;
+
+    MeshState() : handle(NULL), material(0) {
+        for (int i = 0; i < 16; i++) {
+            transform.a[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+        }
+    }
+
+    /** True if next moves the origin by more than translationEpsilon or
+     *  changes a basis element by more than basisEpsilon, which for a
+     *  rotation is about the angle in radians.
+     */
+    bool movedBeyond(const nvarMatrix4x4_t& next, float translationEpsilon, float basisEpsilon) const {
+        float dx = next.a[3] - transform.a[3];
+        float dy = next.a[7] - transform.a[7];
+        float dz = next.a[11] - transform.a[11];
+        if (dx * dx + dy * dy + dz * dz > translationEpsilon * translationEpsilon) {
+            return true;
+        }
+        for (int row = 0; row < 3; row++) {
+            for (int col = 0; col < 3; col++) {
+                if (std::fabs(next.a[row * 4 + col] - transform.a[row * 4 + col]) > basisEpsilon) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+};
+
+/** Listener placement as last set, replayed into a new context **/
+struct ListenerState {
+    nvarFloat3_t location;
+    nvarFloat3_t forward;
+    nvarFloat3_t up;
+    bool hasLocation;
+    bool hasOrientation;
+
+    ListenerState() : hasLocation(false), hasOrientation(false) {
+        location.x = location.y = location.z = 0.0f;
+        forward.x = forward.y = forward.z = 0.0f;
+        up.x = up.y = up.z = 0.0f;
+    }
+};
+
+#endif // GODOTNVAR_SCENE_STATE_H
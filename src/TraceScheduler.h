@@ -0,0 +1,216 @@
+#ifndef GODOTNVAR_TRACE_SCHEDULER_H
+#define GODOTNVAR_TRACE_SCHEDULER_H
+
+#ifdef _WIN32
+// keep windows.h from defining min and max over std::min and std::max
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#endif
+#include "nvar.h"
+#ifndef _WIN32
+#include "cpu/nvarCPU.h"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** Trace done events: Windows events for nvar.dll, portable events for the CPU backend **/
+namespace TraceEvent {
+    inline HANDLE create() {
+#ifdef _WIN32
+        return CreateEvent(NULL, FALSE, FALSE, NULL);
+#else
+        HANDLE event = NULL;
+        return nvarCPUCreateEvent(&event) == NVAR_STATUS_SUCCESS ? event : NULL;
+#endif
+    }
+
+    inline void destroy(HANDLE event) {
+#ifdef _WIN32
+        CloseHandle(event);
+#else
+        nvarCPUDestroyEvent(event);
+#endif
+    }
+
+    /** Returns true if the event was signaled within timeoutMs **/
+    inline bool wait(HANDLE event, int timeoutMs) {
+#ifdef _WIN32
+        return WaitForSingleObject(event, (DWORD)timeoutMs) == WAIT_OBJECT_0;
+#else
+        return nvarCPUWaitEvent(event, timeoutMs) == NVAR_STATUS_SUCCESS;
+#endif
+    }
+}
+
+/** Keeps at most a fixed number of traces in the NVAR command queue and
+ *  reports each one as it finishes. All NVAR calls are made by the caller's
+ *  thread; a background thread only waits on the trace done events and
+ *  passes completed trace numbers to the completion callback, along with
+ *  how long NVAR worked on each: from when it was issued, or when the trace
+ *  before it finished if that was later, until it was done.
+ */
+class TraceScheduler {
+public:
+    typedef std::function<void(uint64_t traceNumber, double milliseconds)> CompletionCallback;
+
+    TraceScheduler() : maxInFlight(2), inFlight(0), nextTrace(1), stopping(false) { }
+
+    ~TraceScheduler() {
+        stop();
+    }
+
+    /** Starts the completion thread. The callback runs on that thread. **/
+    void start(const CompletionCallback& callback) {
+        stop();
+        onCompleted = callback;
+        stopping = false;
+        waiter = std::thread(&TraceScheduler::waitLoop, this);
+    }
+
+    /** Stops the completion thread. Traces still queued are forgotten, so
+     *  call nvarSynchronize first if they matter.
+     */
+    void stop() {
+        if (!waiter.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        waiter.join();
+
+        std::lock_guard<std::mutex> guard(lock);
+        for (size_t i = 0; i < waiting.size(); i++) {
+            freeEvents.push_back(waiting[i].event);
+        }
+        waiting.clear();
+        for (size_t i = 0; i < freeEvents.size(); i++) {
+            TraceEvent::destroy(freeEvents[i]);
+        }
+        freeEvents.clear();
+        inFlight = 0;
+    }
+
+    bool isRunning() const { return waiter.joinable(); }
+
+    void setMaxInFlight(int count) { maxInFlight = count < 1 ? 1 : count; }
+    int getMaxInFlight() const { return maxInFlight; }
+    int getInFlight() const { return inFlight.load(); }
+    bool canIssue() const { return isRunning() && inFlight.load() < maxInFlight; }
+    /** The number the next issued trace will get **/
+    uint64_t getNextTraceNumber() const { return nextTrace; }
+
+    /** Queues a trace with a done event. On success traceNumber identifies
+     *  it in the completion callback.
+     */
+    nvarStatus_t issue(nvar_t nvar, uint64_t& traceNumber) {
+        HANDLE event = acquireEvent();
+        if (event == NULL) {
+            return NVAR_STATUS_OUT_OF_RESOURCES;
+        }
+        nvarStatus_t nvarStatus = nvarTraceAudio(nvar, event);
+        if (nvarStatus != NVAR_STATUS_SUCCESS) {
+            releaseEvent(event);
+            return nvarStatus;
+        }
+
+        traceNumber = nextTrace++;
+        inFlight++;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            Pending pending;
+            pending.event = event;
+            pending.traceNumber = traceNumber;
+            pending.issued = std::chrono::steady_clock::now();
+            waiting.push_back(pending);
+        }
+        wake.notify_one();
+        return NVAR_STATUS_SUCCESS;
+    }
+
+private:
+    struct Pending {
+        HANDLE event;
+        uint64_t traceNumber;
+        std::chrono::steady_clock::time_point issued;
+    };
+
+    /** Polling interval, so stop() never waits on a trace that will not finish **/
+    static const int kWaitSliceMs = 50;
+
+    HANDLE acquireEvent() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!freeEvents.empty()) {
+                HANDLE event = freeEvents.back();
+                freeEvents.pop_back();
+                return event;
+            }
+        }
+        return TraceEvent::create();
+    }
+
+    void releaseEvent(HANDLE event) {
+        std::lock_guard<std::mutex> guard(lock);
+        freeEvents.push_back(event);
+    }
+
+    void waitLoop() {
+        std::unique_lock<std::mutex> guard(lock);
+        while (!stopping) {
+            if (waiting.empty()) {
+                wake.wait(guard);
+                continue;
+            }
+            // the command queue is in order, so traces finish in the order issued
+            Pending pending = waiting.front();
+            guard.unlock();
+            bool done = TraceEvent::wait(pending.event, kWaitSliceMs);
+            guard.lock();
+            if (!done) {
+                continue;
+            }
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            // queued traces wait for the one ahead of them, which is not their cost
+            std::chrono::duration<double, std::milli> busy = now - std::max(pending.issued, lastDone);
+            lastDone = now;
+            waiting.pop_front();
+            freeEvents.push_back(pending.event);
+            inFlight--;
+            guard.unlock();
+            onCompleted(pending.traceNumber, busy.count());
+            guard.lock();
+        }
+    }
+
+    int maxInFlight;
+    std::atomic<int> inFlight;
+    uint64_t nextTrace;
+
+    std::thread waiter;
+    std::mutex lock;
+    std::condition_variable wake;
+    bool stopping;
+    std::deque<Pending> waiting;
+    std::chrono::steady_clock::time_point lastDone;   // waiter thread only
+    std::vector<HANDLE> freeEvents;
+    CompletionCallback onCompleted;
+};
+
+#endif // GODOTNVAR_TRACE_SCHEDULER_H
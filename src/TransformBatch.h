@@ -0,0 +1,92 @@
+#ifndef GODOTNVAR_TRANSFORM_BATCH_H
+#define GODOTNVAR_TRANSFORM_BATCH_H
+
+#include "nvar.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define GODOTNVAR_TRANSFORM_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define GODOTNVAR_TRANSFORM_NEON 1
+#endif
+
+/** Composes many instance transforms with one parent transform into NVAR
+ *  matrices. Transforms come as 12 floats each: the three basis axes (the
+ *  columns of the basis) followed by the origin. Each output column is a
+ *  sum of parent columns scaled by one instance value, which maps onto
+ *  4-wide SIMD; the columns are then transposed into NVAR's row-major
+ *  matrix in registers.
+ */
+class TransformBatch {
+public:
+    static void compose(const float parent[12], const float* instances, int count, nvarMatrix4x4_t* out) {
+        int i = 0;
+#if defined(GODOTNVAR_TRANSFORM_SSE)
+        const __m128 p0 = _mm_setr_ps(parent[0], parent[1], parent[2], 0.0f);
+        const __m128 p1 = _mm_setr_ps(parent[3], parent[4], parent[5], 0.0f);
+        const __m128 p2 = _mm_setr_ps(parent[6], parent[7], parent[8], 0.0f);
+        const __m128 pt = _mm_setr_ps(parent[9], parent[10], parent[11], 1.0f);
+        for (; i < count; i++) {
+            const float* t = instances + 12 * i;
+            __m128 c0 = column(p0, p1, p2, t + 0);
+            __m128 c1 = column(p0, p1, p2, t + 3);
+            __m128 c2 = column(p0, p1, p2, t + 6);
+            __m128 c3 = _mm_add_ps(column(p0, p1, p2, t + 9), pt);
+            _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+            _mm_storeu_ps(out[i].a + 0, c0);
+            _mm_storeu_ps(out[i].a + 4, c1);
+            _mm_storeu_ps(out[i].a + 8, c2);
+            _mm_storeu_ps(out[i].a + 12, c3);
+        }
+#elif defined(GODOTNVAR_TRANSFORM_NEON)
+        const float pc[16] = { parent[0], parent[1], parent[2], 0.0f, parent[3], parent[4], parent[5], 0.0f,
+                               parent[6], parent[7], parent[8], 0.0f, parent[9], parent[10], parent[11], 1.0f };
+        const float32x4_t p0 = vld1q_f32(pc + 0);
+        const float32x4_t p1 = vld1q_f32(pc + 4);
+        const float32x4_t p2 = vld1q_f32(pc + 8);
+        const float32x4_t pt = vld1q_f32(pc + 12);
+        for (; i < count; i++) {
+            const float* t = instances + 12 * i;
+            float32x4x4_t columns;
+            columns.val[0] = column(p0, p1, p2, t + 0);
+            columns.val[1] = column(p0, p1, p2, t + 3);
+            columns.val[2] = column(p0, p1, p2, t + 6);
+            columns.val[3] = vaddq_f32(column(p0, p1, p2, t + 9), pt);
+            // interleaving the four columns stores them transposed, as rows
+            vst4q_f32(out[i].a, columns);
+        }
+#endif
+        for (; i < count; i++) {
+            const float* t = instances + 12 * i;
+            for (int row = 0; row < 3; row++) {
+                for (int col = 0; col < 4; col++) {
+                    const float* c = t + 3 * col;
+                    out[i].a[row * 4 + col] = parent[row] * c[0] + parent[3 + row] * c[1] + parent[6 + row] * c[2] +
+                                              (col == 3 ? parent[9 + row] : 0.0f);
+                }
+            }
+            out[i].a[12] = 0.0f;
+            out[i].a[13] = 0.0f;
+            out[i].a[14] = 0.0f;
+            out[i].a[15] = 1.0f;
+        }
+    }
+
+private:
+#if defined(GODOTNVAR_TRANSFORM_SSE)
+    static __m128 column(__m128 p0, __m128 p1, __m128 p2, const float* v) {
+        __m128 c = _mm_mul_ps(p0, _mm_set1_ps(v[0]));
+        c = _mm_add_ps(c, _mm_mul_ps(p1, _mm_set1_ps(v[1])));
+        return _mm_add_ps(c, _mm_mul_ps(p2, _mm_set1_ps(v[2])));
+    }
+#elif defined(GODOTNVAR_TRANSFORM_NEON)
+    static float32x4_t column(float32x4_t p0, float32x4_t p1, float32x4_t p2, const float* v) {
+        float32x4_t c = vmulq_n_f32(p0, v[0]);
+        c = vmlaq_n_f32(c, p1, v[1]);
+        return vmlaq_n_f32(c, p2, v[2]);
+    }
+#endif
+};
+
+#endif // GODOTNVAR_TRANSFORM_BATCH_H
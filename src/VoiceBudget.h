@@ -0,0 +1,148 @@
+#ifndef GODOTNVAR_VOICE_BUDGET_H
+#define GODOTNVAR_VOICE_BUDGET_H
+
+#include "nvar.h"
+#include "nvarNDA.h"
+#include "HandleTable.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/** Wrapper side state of a sound source. Everything needed to recreate the
+ *  NVAR source is kept here, so a source can be virtualized, its NVAR
+ *  source destroyed, and brought back later under the same id.
+ */
+struct SourceState {
+    nvarSource_t handle;         // NULL while the source is virtual
+    nvarEffect_t effect;         // preset asked for, the most EffectBudget may apply
+    nvarEffect_t appliedEffect;  // preset the NVAR source traces with
+    nvarFloat3_t location;
+    float directGain;
+    float indirectGain;
+    float priority;              // scales the audibility score, 1 by default
+    float occlusion;             // last occlusion attenuation reported by NVAR
+    float score;                 // audibility from the last VoiceBudget::plan
+    int lod;                     // AudioRenderer::SourceLod chosen by the LodPlanner
+    int64_t position;            // input samples consumed, whether live or virtual
+    int64_t virtualClock;        // audio clock when virtual input was last consumed
+    int virtualQueued;           // input pushed while virtual that the clock has not reached yet
+
+    explicit SourceState(nvarEffect_t effect = NVAR_EFFECT_LOW) : handle(NULL), effect(effect), appliedEffect(effect),
+                                                                  directGain(1.0f), indirectGain(1.0f), priority(1.0f),
+                                                                  occlusion(1.0f), score(0.0f), lod(0), position(0),
+                                                                  virtualClock(0), virtualQueued(0) {
+        location.x = 0.0f;
+        location.y = 0.0f;
+        location.z = 0.0f;
+    }
+
+    bool isLive() const { return handle != NULL; }
+
+    /** Discards virtual input at the rate a live source would consume it **/
+    void consumeVirtual(int64_t clock) {
+        int64_t consumed = std::min<int64_t>(virtualQueued, std::max<int64_t>(clock - virtualClock, 0));
+        virtualClock = clock;
+        virtualQueued -= (int)consumed;
+        position += consumed;
+    }
+};
+
+/** Decides which sources keep a live NVAR source when there are more than
+ *  the budget allows. Sources are ranked by an audibility score of gain,
+ *  occlusion and distance, weighted by their priority. A virtual source
+ *  only replaces a live one if it scores better by the hysteresis factor,
+ *  so sources near the cut do not flip every frame.
+ */
+class VoiceBudget {
+public:
+    VoiceBudget() : maxLive(0), hysteresis(1.25f), referenceDistance(1.0f) { }
+
+    /** At most this many live sources. 0 means no limit. **/
+    void setMaxLive(int count) { maxLive = std::max(count, 0); }
+    int getMaxLive() const { return maxLive; }
+
+    void setHysteresis(float factor) { hysteresis = std::max(factor, 1.0f); }
+    float getHysteresis() const { return hysteresis; }
+
+    /** Distance below which sources are not louder, in NVAR units **/
+    void setReferenceDistance(float distance) { referenceDistance = std::max(distance, 1e-3f); }
+    float getReferenceDistance() const { return referenceDistance; }
+
+    /** Scores every source and lists the ids to park and to make live so
+     *  the live set stays within the budget. Live sources refresh their
+     *  distance and occlusion from nvarGetSourceDetails; virtual sources use
+     *  their location and the last occlusion they had.
+     */
+    void plan(HandleTable<SourceState>& sources, const nvarFloat3_t& listener,
+              std::vector<int64_t>& park, std::vector<int64_t>& realize) {
+        park.clear();
+        realize.clear();
+        live.clear();
+        parked.clear();
+        for (int i = 0; i < sources.size(); i++) {
+            SourceState& state = sources.at(i);
+            state.score = score(state, listener);
+            (state.isLive() ? live : parked).push_back(Ranked(state.score, sources.idAt(i)));
+        }
+
+        if (maxLive <= 0) {
+            for (size_t i = 0; i < parked.size(); i++) {
+                realize.push_back(parked[i].id);
+            }
+            return;
+        }
+
+        // weakest live source first, strongest virtual source first
+        std::sort(live.begin(), live.end(), [](const Ranked& a, const Ranked& b) { return a.score < b.score; });
+        std::sort(parked.begin(), parked.end(), [](const Ranked& a, const Ranked& b) { return a.score > b.score; });
+        size_t weakest = 0;
+        size_t strongest = 0;
+        int liveCount = (int)live.size();
+        while (liveCount > maxLive) {
+            park.push_back(live[weakest++].id);
+            liveCount--;
+        }
+        while (liveCount < maxLive && strongest < parked.size()) {
+            realize.push_back(parked[strongest++].id);
+            liveCount++;
+        }
+        while (weakest < live.size() && strongest < parked.size() &&
+               parked[strongest].score > live[weakest].score * hysteresis) {
+            park.push_back(live[weakest++].id);
+            realize.push_back(parked[strongest++].id);
+        }
+    }
+
+private:
+    struct Ranked {
+        float score;
+        int64_t id;
+        Ranked(float score, int64_t id) : score(score), id(id) { }
+    };
+
+    float score(SourceState& state, const nvarFloat3_t& listener) const {
+        float distance;
+        nvarSourceDetails_t details;
+        if (state.isLive() && nvarGetSourceDetails(state.handle, &details) == NVAR_STATUS_SUCCESS) {
+            distance = details.distance;
+            state.occlusion = details.occlusionAttenuation;
+        } else {
+            float dx = state.location.x - listener.x;
+            float dy = state.location.y - listener.y;
+            float dz = state.location.z - listener.z;
+            distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+        }
+        float gain = std::max(state.directGain, state.indirectGain);
+        return state.priority * gain * state.occlusion / std::max(distance, referenceDistance);
+    }
+
+    int maxLive;
+    float hysteresis;
+    float referenceDistance;
+    std::vector<Ranked> live;
+    std::vector<Ranked> parked;
+};
+
+#endif // GODOTNVAR_VOICE_BUDGET_H
@@ -0,0 +1,299 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace nvarcpu {
+
+namespace {
+
+const int kBinCount = 12;
+const int kMaxLeafSize = 4;
+const int kMaxDepth = 64;
+const float kRayEpsilon = 1e-4f;
+
+struct Bounds {
+    Vec3 lo;
+    Vec3 hi;
+
+    Bounds() : lo(FLT_MAX, FLT_MAX, FLT_MAX), hi(-FLT_MAX, -FLT_MAX, -FLT_MAX) { }
+
+    void grow(const Vec3& p) {
+        lo = minVec(lo, p);
+        hi = maxVec(hi, p);
+    }
+
+    void grow(const Bounds& b) {
+        lo = minVec(lo, b.lo);
+        hi = maxVec(hi, b.hi);
+    }
+
+    float area() const {
+        Vec3 d = hi - lo;
+        if (d.x < 0.0f) {
+            return 0.0f;
+        }
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+};
+
+Bounds triangleBounds(const Triangle& t) {
+    Bounds b;
+    b.grow(t.v0);
+    b.grow(t.v0 + t.e1);
+    b.grow(t.v0 + t.e2);
+    return b;
+}
+
+/** Slab test, returns the entry distance or FLT_MAX on a miss **/
+inline float intersectBounds(const BVHNode& node, const Vec3& origin, const Vec3& invDir, float tMax) {
+    float tx1 = (node.boundsMin.x - origin.x) * invDir.x;
+    float tx2 = (node.boundsMax.x - origin.x) * invDir.x;
+    float tmin = std::fmin(tx1, tx2);
+    float tmax = std::fmax(tx1, tx2);
+    float ty1 = (node.boundsMin.y - origin.y) * invDir.y;
+    float ty2 = (node.boundsMax.y - origin.y) * invDir.y;
+    tmin = std::fmax(tmin, std::fmin(ty1, ty2));
+    tmax = std::fmin(tmax, std::fmax(ty1, ty2));
+    float tz1 = (node.boundsMin.z - origin.z) * invDir.z;
+    float tz2 = (node.boundsMax.z - origin.z) * invDir.z;
+    tmin = std::fmax(tmin, std::fmin(tz1, tz2));
+    tmax = std::fmin(tmax, std::fmax(tz1, tz2));
+    if (tmax >= tmin && tmax > 0.0f && tmin < tMax) {
+        return tmin;
+    }
+    return FLT_MAX;
+}
+
+/** Moller-Trumbore, returns the hit distance or -1 **/
+inline float intersectTriangle(const Triangle& tri, const Vec3& origin, const Vec3& dir) {
+    Vec3 p = cross(dir, tri.e2);
+    float det = dot(tri.e1, p);
+    if (std::fabs(det) < 1e-12f) {
+        return -1.0f;
+    }
+    float inv = 1.0f / det;
+    Vec3 s = origin - tri.v0;
+    float u = dot(s, p) * inv;
+    if (u < 0.0f || u > 1.0f) {
+        return -1.0f;
+    }
+    Vec3 q = cross(s, tri.e1);
+    float v = dot(dir, q) * inv;
+    if (v < 0.0f || u + v > 1.0f) {
+        return -1.0f;
+    }
+    return dot(tri.e2, q) * inv;
+}
+
+inline Vec3 safeInverse(const Vec3& d) {
+    return Vec3(d.x != 0.0f ? 1.0f / d.x : FLT_MAX,
+                d.y != 0.0f ? 1.0f / d.y : FLT_MAX,
+                d.z != 0.0f ? 1.0f / d.z : FLT_MAX);
+}
+
+} // namespace
+
+void BVH::build(std::vector<Triangle> triangles) {
+    tris.swap(triangles);
+    nodes.clear();
+    if (tris.empty()) {
+        return;
+    }
+    nodes.reserve(tris.size() * 2);
+
+    std::vector<Vec3> centroids(tris.size());
+    for (size_t i = 0; i < tris.size(); i++) {
+        const Triangle& t = tris[i];
+        centroids[i] = t.v0 + (t.e1 + t.e2) * (1.0f / 3.0f);
+    }
+    buildNode(0, (int)tris.size(), centroids, 0);
+}
+
+int BVH::buildNode(int first, int count, std::vector<Vec3>& centroids, int depth) {
+    int index = (int)nodes.size();
+    nodes.push_back(BVHNode());
+
+    Bounds bounds;
+    Bounds centroidBounds;
+    for (int i = first; i < first + count; i++) {
+        bounds.grow(triangleBounds(tris[i]));
+        centroidBounds.grow(centroids[i]);
+    }
+    nodes[index].boundsMin = bounds.lo;
+    nodes[index].boundsMax = bounds.hi;
+
+    if (count <= kMaxLeafSize || depth >= kMaxDepth) {
+        nodes[index].first = first;
+        nodes[index].count = count;
+        return index;
+    }
+
+    // choose the split with the lowest SAH cost over binned centroids
+    int bestAxis = -1;
+    int bestSplit = 0;
+    float bestCost = FLT_MAX;
+    for (int axis = 0; axis < 3; axis++) {
+        float lo = centroidBounds.lo[axis];
+        float extent = centroidBounds.hi[axis] - lo;
+        if (extent <= 0.0f) {
+            continue;
+        }
+        float scale = kBinCount / extent;
+
+        Bounds binBounds[kBinCount];
+        int binCount[kBinCount] = { 0 };
+        for (int i = first; i < first + count; i++) {
+            int b = std::min(kBinCount - 1, (int)((centroids[i][axis] - lo) * scale));
+            binCount[b]++;
+            binBounds[b].grow(triangleBounds(tris[i]));
+        }
+
+        float leftArea[kBinCount - 1];
+        int leftCount[kBinCount - 1];
+        Bounds acc;
+        int n = 0;
+        for (int b = 0; b < kBinCount - 1; b++) {
+            acc.grow(binBounds[b]);
+            n += binCount[b];
+            leftArea[b] = acc.area();
+            leftCount[b] = n;
+        }
+        acc = Bounds();
+        n = 0;
+        for (int b = kBinCount - 1; b > 0; b--) {
+            acc.grow(binBounds[b]);
+            n += binCount[b];
+            float cost = leftArea[b - 1] * leftCount[b - 1] + acc.area() * n;
+            if (leftCount[b - 1] > 0 && n > 0 && cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = b;
+            }
+        }
+    }
+
+    int mid;
+    if (bestAxis < 0 || bestCost >= bounds.area() * count) {
+        if (bestAxis < 0) {
+            // all centroids coincide, split in the middle so the tree stays bounded
+            mid = first + count / 2;
+        } else {
+            nodes[index].first = first;
+            nodes[index].count = count;
+            return index;
+        }
+    } else {
+        float lo = centroidBounds.lo[bestAxis];
+        float scale = kBinCount / (centroidBounds.hi[bestAxis] - lo);
+        int i = first;
+        int j = first + count - 1;
+        while (i <= j) {
+            int b = std::min(kBinCount - 1, (int)((centroids[i][bestAxis] - lo) * scale));
+            if (b < bestSplit) {
+                i++;
+            } else {
+                std::swap(tris[i], tris[j]);
+                std::swap(centroids[i], centroids[j]);
+                j--;
+            }
+        }
+        mid = i;
+        if (mid == first || mid == first + count) {
+            mid = first + count / 2;
+        }
+    }
+
+    buildNode(first, mid - first, centroids, depth + 1);
+    int right = buildNode(mid, first + count - mid, centroids, depth + 1);
+    nodes[index].first = right;
+    nodes[index].count = 0;
+    return index;
+}
+
+bool BVH::intersect(const Vec3& origin, const Vec3& direction, float tMax, Hit& hit) const {
+    if (nodes.empty()) {
+        return false;
+    }
+    Vec3 invDir = safeInverse(direction);
+    int stack[kMaxDepth * 2 + 2];
+    int top = 0;
+    stack[top++] = 0;
+    float closest = tMax;
+    int closestTri = -1;
+
+    while (top > 0) {
+        const BVHNode& node = nodes[stack[--top]];
+        if (intersectBounds(node, origin, invDir, closest) == FLT_MAX) {
+            continue;
+        }
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first + node.count; i++) {
+                float t = intersectTriangle(tris[i], origin, direction);
+                if (t > kRayEpsilon && t < closest) {
+                    closest = t;
+                    closestTri = i;
+                }
+            }
+        } else {
+            // visit the nearer child first
+            int left = (int)(&node - &nodes[0]) + 1;
+            int right = node.first;
+            float dl = intersectBounds(nodes[left], origin, invDir, closest);
+            float dr = intersectBounds(nodes[right], origin, invDir, closest);
+            if (dl <= dr) {
+                if (dr != FLT_MAX) stack[top++] = right;
+                if (dl != FLT_MAX) stack[top++] = left;
+            } else {
+                if (dl != FLT_MAX) stack[top++] = left;
+                if (dr != FLT_MAX) stack[top++] = right;
+            }
+        }
+    }
+
+    if (closestTri < 0) {
+        return false;
+    }
+    const Triangle& tri = tris[closestTri];
+    hit.t = closest;
+    hit.triangle = closestTri;
+    hit.normal = normalize(cross(tri.e1, tri.e2));
+    return true;
+}
+
+float BVH::transmittance(const Vec3& from, const Vec3& to, const float* materialTransmission) const {
+    if (nodes.empty()) {
+        return 1.0f;
+    }
+    Vec3 direction = to - from;
+    Vec3 invDir = safeInverse(direction);
+    const float tEnd = 1.0f - kRayEpsilon;
+    int stack[kMaxDepth * 2 + 2];
+    int top = 0;
+    stack[top++] = 0;
+    float result = 1.0f;
+
+    while (top > 0) {
+        const BVHNode& node = nodes[stack[--top]];
+        if (intersectBounds(node, from, invDir, tEnd) == FLT_MAX) {
+            continue;
+        }
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first + node.count; i++) {
+                float t = intersectTriangle(tris[i], from, direction);
+                if (t > kRayEpsilon && t < tEnd) {
+                    result *= materialTransmission[tris[i].material];
+                    if (result < 1e-4f) {
+                        return 0.0f;
+                    }
+                }
+            }
+        } else {
+            stack[top++] = node.first;
+            stack[top++] = (int)(&node - &nodes[0]) + 1;
+        }
+    }
+    return result;
+}
+
+} // namespace nvarcpu
@@ -0,0 +1,59 @@
+#ifndef GODOTNVAR_CPU_BVH_H
+#define GODOTNVAR_CPU_BVH_H
+
+#include <vector>
+
+#include "Math.h"
+
+namespace nvarcpu {
+
+/** World-space triangle with precomputed edges for ray intersection **/
+struct Triangle {
+    Vec3 v0;
+    Vec3 e1;
+    Vec3 e2;
+    int material;   // index into the scene material table
+};
+
+struct BVHNode {
+    Vec3 boundsMin;
+    Vec3 boundsMax;
+    int first;      // first triangle for leaves, right child for interior nodes
+    int count;      // triangle count, 0 for interior nodes
+};
+
+struct Hit {
+    float t;
+    int triangle;
+    Vec3 normal;    // unit geometric normal, not oriented
+};
+
+/** Bounding volume hierarchy over the committed scene triangles,
+ *  built with a binned surface area heuristic.
+ */
+class BVH {
+public:
+    void build(std::vector<Triangle> triangles);
+
+    bool empty() const { return tris.empty(); }
+    int getTriangleCount() const { return (int)tris.size(); }
+    const Triangle& getTriangle(int i) const { return tris[i]; }
+
+    /** Finds the closest hit along origin + t * direction for t in (0, tMax) **/
+    bool intersect(const Vec3& origin, const Vec3& direction, float tMax, Hit& hit) const;
+
+    /** Multiplies the transmission coefficient of every surface between
+     *  `from` and `to`. Returns 1.0 for an unobstructed segment.
+     */
+    float transmittance(const Vec3& from, const Vec3& to, const float* materialTransmission) const;
+
+private:
+    int buildNode(int first, int count, std::vector<Vec3>& centroids, int depth);
+
+    std::vector<Triangle> tris;
+    std::vector<BVHNode> nodes;
+};
+
+} // namespace nvarcpu
+
+#endif // GODOTNVAR_CPU_BVH_H
@@ -0,0 +1,92 @@
+#ifndef GODOTNVAR_CPU_MATH_H
+#define GODOTNVAR_CPU_MATH_H
+
+#include <cmath>
+#include <cstdint>
+
+#include "nvar.h"
+
+namespace nvarcpu {
+
+struct Vec3 {
+    float x, y, z;
+
+    Vec3() : x(0.0f), y(0.0f), z(0.0f) { }
+    Vec3(float px, float py, float pz) : x(px), y(py), z(pz) { }
+    explicit Vec3(const nvarFloat3_t& v) : x(v.x), y(v.y), z(v.z) { }
+
+    float operator[](int i) const { return i == 0 ? x : (i == 1 ? y : z); }
+
+    Vec3 operator+(const Vec3& o) const { return Vec3(x + o.x, y + o.y, z + o.z); }
+    Vec3 operator-(const Vec3& o) const { return Vec3(x - o.x, y - o.y, z - o.z); }
+    Vec3 operator*(float s) const { return Vec3(x * s, y * s, z * s); }
+    Vec3 operator-() const { return Vec3(-x, -y, -z); }
+
+    nvarFloat3_t toNvar() const {
+        nvarFloat3_t v;
+        v.x = x;
+        v.y = y;
+        v.z = z;
+        return v;
+    }
+};
+
+inline float dot(const Vec3& a, const Vec3& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline Vec3 cross(const Vec3& a, const Vec3& b) {
+    return Vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+inline float length(const Vec3& v) {
+    return std::sqrt(dot(v, v));
+}
+
+inline Vec3 normalize(const Vec3& v) {
+    float l = length(v);
+    return l > 0.0f ? v * (1.0f / l) : Vec3(0.0f, 0.0f, 0.0f);
+}
+
+inline Vec3 minVec(const Vec3& a, const Vec3& b) {
+    return Vec3(std::fmin(a.x, b.x), std::fmin(a.y, b.y), std::fmin(a.z, b.z));
+}
+
+inline Vec3 maxVec(const Vec3& a, const Vec3& b) {
+    return Vec3(std::fmax(a.x, b.x), std::fmax(a.y, b.y), std::fmax(a.z, b.z));
+}
+
+/** Applies an NVAR row-major 4x4 transform to a point **/
+inline Vec3 transformPoint(const nvarMatrix4x4_t& m, const Vec3& p) {
+    return Vec3(m.a[0] * p.x + m.a[1] * p.y + m.a[2] * p.z + m.a[3],
+                m.a[4] * p.x + m.a[5] * p.y + m.a[6] * p.z + m.a[7],
+                m.a[8] * p.x + m.a[9] * p.y + m.a[10] * p.z + m.a[11]);
+}
+
+/** Small counter-based generator so every ray gets a reproducible stream
+ *  no matter which worker thread traces it.
+ */
+struct Random {
+    uint64_t state;
+
+    explicit Random(uint64_t seed) : state(seed * 0x9E3779B97F4A7C15ull + 0x632BE59BD9B4E019ull) {
+        next();
+    }
+
+    uint32_t next() {
+        uint64_t old = state;
+        state = old * 6364136223846793005ull + 1442695040888963407ull;
+        uint32_t xorshifted = (uint32_t)(((old >> 18u) ^ old) >> 27u);
+        uint32_t rot = (uint32_t)(old >> 59u);
+        return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+    }
+
+    /** Uniform float in [0, 1) **/
+    float uniform() {
+        return (next() >> 8) * (1.0f / 16777216.0f);
+    }
+};
+
+} // namespace nvarcpu
+
+#endif // GODOTNVAR_CPU_MATH_H
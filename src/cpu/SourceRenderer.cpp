@@ -0,0 +1,249 @@
+#include "SourceRenderer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace nvarcpu {
+
+namespace {
+
+/** Smallest partition the indirect convolver uses, to keep FFT overhead sane **/
+const int kMinPartitionSize = 32;
+
+void writeOutput(float* out, const float* in, float fromGain, float toGain, int n, bool accumulate) {
+    float step = (toGain - fromGain) / n;
+    float g = fromGain;
+    if (accumulate) {
+        for (int i = 0; i < n; i++) {
+            g += step;
+            out[i] += in[i] * g;
+        }
+    } else {
+        for (int i = 0; i < n; i++) {
+            g += step;
+            out[i] = in[i] * g;
+        }
+    }
+}
+
+} // namespace
+
+void SourceFilters::render(float* filterArray, int arrayLength) const {
+    int perChannel = arrayLength / kChannels;
+    for (int ch = 0; ch < kChannels; ch++) {
+        float* dst = filterArray + (size_t)perChannel * ch;
+        int count = std::min(perChannel, (int)indirect[ch].size());
+        std::memcpy(dst, indirect[ch].data(), count * sizeof(float));
+        std::fill(dst + count, dst + perChannel, 0.0f);
+
+        // direct path as a linearly interpolated impulse
+        int tap = (int)directDelay[ch];
+        float frac = directDelay[ch] - tap;
+        if (tap < perChannel) {
+            dst[tap] += directGain[ch] * (1.0f - frac);
+        }
+        if (tap + 1 < perChannel) {
+            dst[tap + 1] += directGain[ch] * frac;
+        }
+    }
+}
+
+void DirectRenderer::prepare(int maxBlock, int filterLength) {
+    int size = dsp::nextPowerOfTwo(filterLength + maxBlock + 4);
+    ring.assign(size, 0.0f);
+    mask = size - 1;
+    writePos = 0;
+    primed = false;
+}
+
+void DirectRenderer::process(const SourceFilters* filters, float gain, const float* in, int numSamples,
+                             float* const* out, bool accumulate) {
+    int needed = (filters ? filters->length : 0) + numSamples + 4;
+    if ((int)ring.size() < needed) {
+        prepare(numSamples, filters ? filters->length : 0);
+    }
+
+    unsigned start = writePos;
+    for (int i = 0; i < numSamples; i++) {
+        ring[(start + i) & mask] = in[i];
+    }
+    writePos += numSamples;
+
+    for (int ch = 0; ch < kChannels; ch++) {
+        float targetDelay = 0.0f;
+        float targetGain = 0.0f;
+        if (filters) {
+            targetDelay = filters->directDelay[ch];
+            // paths longer than the filter are dropped, like the library does
+            targetGain = targetDelay < filters->length ? filters->directGain[ch] * gain : 0.0f;
+        }
+        if (!primed) {
+            currentDelay[ch] = targetDelay;
+            currentGain[ch] = targetGain;
+        }
+
+        float delayStep = (targetDelay - currentDelay[ch]) / numSamples;
+        float gainStep = (targetGain - currentGain[ch]) / numSamples;
+        float delay = currentDelay[ch];
+        float g = currentGain[ch];
+        float* dst = out[ch];
+        for (int i = 0; i < numSamples; i++) {
+            delay += delayStep;
+            g += gainStep;
+            float position = (float)i - delay;
+            float whole = std::floor(position);
+            float frac = position - whole;
+            unsigned index = start + (int)whole;
+            float sample = ring[index & mask] * (1.0f - frac) + ring[(index + 1) & mask] * frac;
+            if (accumulate) {
+                dst[i] += sample * g;
+            } else {
+                dst[i] = sample * g;
+            }
+        }
+        currentDelay[ch] = targetDelay;
+        currentGain[ch] = targetGain;
+    }
+    primed = true;
+}
+
+void IndirectRenderer::prepare(int numSamples, int filterLength) {
+    blockSize = numSamples;
+    partitionSize = std::max(kMinPartitionSize, dsp::nextPowerOfTwo(numSamples));
+    aligned = partitionSize == numSamples;
+    int partitions = std::max(1, (filterLength + partitionSize - 1) / partitionSize);
+    convolver.init(partitionSize, partitions);
+
+    inFifo.assign(partitionSize, 0.0f);
+    inCount = 0;
+    int ringSize = dsp::nextPowerOfTwo(4 * partitionSize);
+    outMask = ringSize - 1;
+    for (int ch = 0; ch < kChannels; ch++) {
+        outRing[ch].assign(ringSize, 0.0f);
+        blockOut[ch].assign(partitionSize, 0.0f);
+        localSpectrum[ch] = dsp::FilterSpectrum();
+    }
+    spectrumRe.assign(convolver.getBins(), 0.0f);
+    spectrumIm.assign(convolver.getBins(), 0.0f);
+    outRead = 0;
+    // one partition of latency keeps the output FIFO from ever running dry
+    outCount = aligned ? 0 : partitionSize;
+    localFor = nullptr;
+}
+
+const dsp::FilterSpectrum* IndirectRenderer::selectSpectra(const SourceFilters* filters) {
+    if (!filters) {
+        return nullptr;
+    }
+    if (filters->spectrum[0].partitionSize == partitionSize) {
+        return filters->spectrum;
+    }
+    // the trace did not know our block size yet, transform here once per filter update
+    if (localFor != filters) {
+        for (int ch = 0; ch < kChannels; ch++) {
+            localSpectrum[ch].build(convolver.getFFT(), filters->indirect[ch].data(),
+                                    (int)filters->indirect[ch].size(), partitionSize);
+        }
+        localFor = filters;
+    }
+    return localSpectrum;
+}
+
+void IndirectRenderer::reservePartitions(const dsp::FilterSpectrum* spectra) {
+    if (spectra && spectra[0].numPartitions > convolver.getMaxPartitions()) {
+        // reverb length grew, the delay line has to grow with it
+        convolver.init(partitionSize, spectra[0].numPartitions);
+    }
+}
+
+void IndirectRenderer::runBlock(const float* in, const dsp::FilterSpectrum* spectra) {
+    reservePartitions(spectra);
+    convolver.pushInput(in);
+    for (int ch = 0; ch < kChannels; ch++) {
+        if (spectra) {
+            convolver.convolve(spectra[ch], blockOut[ch].data(), false);
+        } else {
+            std::fill(blockOut[ch].begin(), blockOut[ch].end(), 0.0f);
+        }
+    }
+}
+
+void IndirectRenderer::process(const SourceFilters* filters, float gain, const float* in, int numSamples,
+                               float* const* out, bool accumulate) {
+    if (!isPrepared(numSamples)) {
+        prepare(numSamples, filters ? filters->length : 0);
+    }
+    const dsp::FilterSpectrum* spectra = selectSpectra(filters);
+
+    if (aligned) {
+        runBlock(in, spectra);
+        for (int ch = 0; ch < kChannels; ch++) {
+            writeOutput(out[ch], blockOut[ch].data(), lastGain, gain, numSamples, accumulate);
+        }
+        lastGain = gain;
+        return;
+    }
+
+    int consumed = 0;
+    while (consumed < numSamples) {
+        int take = std::min(partitionSize - inCount, numSamples - consumed);
+        std::memcpy(&inFifo[inCount], in + consumed, take * sizeof(float));
+        inCount += take;
+        consumed += take;
+        if (inCount == partitionSize) {
+            runBlock(inFifo.data(), spectra);
+            int writeAt = outRead + outCount;
+            for (int ch = 0; ch < kChannels; ch++) {
+                for (int i = 0; i < partitionSize; i++) {
+                    outRing[ch][(writeAt + i) & outMask] = blockOut[ch][i];
+                }
+            }
+            outCount += partitionSize;
+            inCount = 0;
+        }
+    }
+
+    float step = (gain - lastGain) / numSamples;
+    for (int ch = 0; ch < kChannels; ch++) {
+        float g = lastGain;
+        float* dst = out[ch];
+        for (int i = 0; i < numSamples; i++) {
+            g += step;
+            float sample = outRing[ch][(outRead + i) & outMask] * g;
+            dst[i] = accumulate ? dst[i] + sample : sample;
+        }
+    }
+    outRead = (outRead + numSamples) & outMask;
+    outCount -= numSamples;
+    lastGain = gain;
+}
+
+bool IndirectRenderer::accumulateSpectrum(const SourceFilters* filters, float gain, const float* in, int numSamples,
+                                          float* const* accRe, float* const* accIm) {
+    if (!isPrepared(numSamples)) {
+        prepare(numSamples, filters ? filters->length : 0);
+    }
+    if (!aligned) {
+        return false;
+    }
+    const dsp::FilterSpectrum* spectra = selectSpectra(filters);
+    reservePartitions(spectra);
+    convolver.pushInput(in);
+    // the gain is applied per block here, a change steps at the block boundary
+    lastGain = gain;
+    if (!spectra || gain == 0.0f) {
+        return true;
+    }
+
+    int bins = convolver.getBins();
+    for (int ch = 0; ch < kChannels; ch++) {
+        std::fill(spectrumRe.begin(), spectrumRe.end(), 0.0f);
+        std::fill(spectrumIm.begin(), spectrumIm.end(), 0.0f);
+        convolver.multiplyAccumulate(spectra[ch], spectrumRe.data(), spectrumIm.data());
+        dsp::scaleAccumulate(spectrumRe.data(), gain, accRe[ch], bins);
+        dsp::scaleAccumulate(spectrumIm.data(), gain, accIm[ch], bins);
+    }
+    return true;
+}
+
+} // namespace nvarcpu
@@ -0,0 +1,98 @@
+#ifndef GODOTNVAR_CPU_SOURCE_RENDERER_H
+#define GODOTNVAR_CPU_SOURCE_RENDERER_H
+
+#include <vector>
+
+#include "../dsp/PartitionedConvolver.h"
+#include "Tracer.h"
+
+namespace nvarcpu {
+
+/** Filters produced by one trace for one source. Immutable once published
+ *  to the audio thread.
+ */
+struct SourceFilters {
+    int length;
+    int sampleRate;
+    DirectPath direct;
+    float directDelay[kChannels];
+    float directGain[kChannels];
+    std::vector<float> indirect[kChannels];
+    dsp::FilterSpectrum spectrum[kChannels];   // empty unless prebuilt for the renderer's partition size
+
+    /** Writes the combined direct + indirect filter for every channel,
+     *  in the layout returned by nvarGetSourceFilters.
+     */
+    void render(float* filterArray, int arrayLength) const;
+};
+
+/** Renders the direct path as a fractional delay with gain, interpolated
+ *  across each block so filter updates do not click.
+ */
+class DirectRenderer {
+public:
+    DirectRenderer() : mask(0), writePos(0), primed(false) { }
+
+    void prepare(int maxBlock, int filterLength);
+    void process(const SourceFilters* filters, float gain, const float* in, int numSamples,
+                 float* const* out, bool accumulate);
+
+private:
+    std::vector<float> ring;
+    int mask;
+    unsigned writePos;
+    bool primed;
+    float currentDelay[kChannels];
+    float currentGain[kChannels];
+};
+
+/** Renders the indirect path with a uniformly partitioned convolver.
+ *  Block sizes that are a power of two run without added latency; other
+ *  sizes are buffered through FIFOs with one partition of latency.
+ */
+class IndirectRenderer {
+public:
+    IndirectRenderer() : blockSize(0), partitionSize(0), aligned(false), inCount(0),
+                         outRead(0), outCount(0), outMask(0), localFor(nullptr), lastGain(0.0f) { }
+
+    void prepare(int numSamples, int filterLength);
+    bool isPrepared(int numSamples) const { return blockSize == numSamples; }
+    int getPartitionSize() const { return partitionSize; }
+
+    void process(const SourceFilters* filters, float gain, const float* in, int numSamples,
+                 float* const* out, bool accumulate);
+
+    /** Batched variant of process: adds gain times this block's filtered
+     *  spectrum to accRe/accIm for each channel and leaves the inverse
+     *  transform to the caller, so many sources can share one. Returns false
+     *  without consuming the input when the block size needs the buffered path.
+     */
+    bool accumulateSpectrum(const SourceFilters* filters, float gain, const float* in, int numSamples,
+                            float* const* accRe, float* const* accIm);
+
+private:
+    const dsp::FilterSpectrum* selectSpectra(const SourceFilters* filters);
+    void reservePartitions(const dsp::FilterSpectrum* spectra);
+    void runBlock(const float* in, const dsp::FilterSpectrum* spectra);
+
+    dsp::UniformConvolver convolver;
+    int blockSize;
+    int partitionSize;
+    bool aligned;
+    std::vector<float> inFifo;
+    int inCount;
+    std::vector<float> outRing[kChannels];
+    int outRead;
+    int outCount;
+    int outMask;
+    std::vector<float> blockOut[kChannels];
+    std::vector<float> spectrumRe;
+    std::vector<float> spectrumIm;
+    dsp::FilterSpectrum localSpectrum[kChannels];
+    const SourceFilters* localFor;
+    float lastGain;
+};
+
+} // namespace nvarcpu
+
+#endif // GODOTNVAR_CPU_SOURCE_RENDERER_H
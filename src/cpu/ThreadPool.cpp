@@ -0,0 +1,88 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace nvarcpu {
+
+ThreadPool::ThreadPool(int threads)
+    : job(nullptr), jobCount(0), jobGrain(1), nextChunk(0),
+      activeWorkers(0), generation(0), stopping(false) {
+    if (threads <= 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (int i = 1; i < threads; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+}
+
+void ThreadPool::parallelFor(int count, int grain, const RangeFunction& fn) {
+    if (count <= 0) {
+        return;
+    }
+    grain = std::max(1, grain);
+    if (workers.empty() || count <= grain) {
+        fn(0, count, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        job = &fn;
+        jobCount = count;
+        jobGrain = grain;
+        nextChunk.store(0);
+        activeWorkers = (int)workers.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    runChunks(0);
+
+    std::unique_lock<std::mutex> guard(lock);
+    done.wait(guard, [this] { return activeWorkers == 0; });
+    job = nullptr;
+}
+
+void ThreadPool::runChunks(int worker) {
+    for (;;) {
+        int begin = nextChunk.fetch_add(jobGrain);
+        if (begin >= jobCount) {
+            return;
+        }
+        (*job)(begin, std::min(begin + jobGrain, jobCount), worker);
+    }
+}
+
+void ThreadPool::workerLoop(int worker) {
+    unsigned seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+
+        runChunks(worker);
+
+        std::lock_guard<std::mutex> guard(lock);
+        if (--activeWorkers == 0) {
+            done.notify_one();
+        }
+    }
+}
+
+} // namespace nvarcpu
@@ -0,0 +1,49 @@
+#ifndef GODOTNVAR_CPU_THREAD_POOL_H
+#define GODOTNVAR_CPU_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nvarcpu {
+
+/** Fixed set of worker threads used to split a trace across cores.
+ *  The thread calling parallelFor() joins in as worker 0.
+ */
+class ThreadPool {
+public:
+    typedef std::function<void(int begin, int end, int worker)> RangeFunction;
+
+    /** threads <= 0 uses one thread per hardware core **/
+    explicit ThreadPool(int threads);
+    ~ThreadPool();
+
+    /** Number of workers including the calling thread **/
+    int getThreadCount() const { return (int)workers.size() + 1; }
+
+    /** Runs fn over [0, count) in chunks of `grain` and returns when all chunks are done **/
+    void parallelFor(int count, int grain, const RangeFunction& fn);
+
+private:
+    void workerLoop(int worker);
+    void runChunks(int worker);
+
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const RangeFunction* job;
+    int jobCount;
+    int jobGrain;
+    std::atomic<int> nextChunk;
+    int activeWorkers;
+    unsigned generation;
+    bool stopping;
+};
+
+} // namespace nvarcpu
+
+#endif // GODOTNVAR_CPU_THREAD_POOL_H
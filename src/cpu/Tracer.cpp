@@ -0,0 +1,204 @@
+#include "Tracer.h"
+#include "../dsp/MathConstants.h"
+
+#include <algorithm>
+
+namespace nvarcpu {
+
+namespace {
+
+/** Rays and bounce limit per effect preset, scaled by the compute preset **/
+const int kEffectRays[NVAR_NUM_EFFECT_PRESETS] = { 512, 1024, 2048, 4096 };
+const int kEffectBounces[NVAR_NUM_EFFECT_PRESETS] = { 32, 64, 128, 256 };
+
+/** Radius of the listener's head in meters, used for interaural delay **/
+const float kHeadRadius = 0.0875f;
+
+/** How strongly lateral sources are panned between the ears **/
+const float kPanDepth = 0.7f;
+
+float computeScale(nvarPreset_t preset) {
+    switch (preset) {
+        case NVAR_COMPUTE_LOW: return 0.5f;
+        case NVAR_COMPUTE_PRO: return 2.0f;
+        default: return 1.0f;
+    }
+}
+
+Vec3 uniformSphere(Random& rng) {
+    float z = 1.0f - 2.0f * rng.uniform();
+    float r = std::sqrt(std::fmax(0.0f, 1.0f - z * z));
+    float phi = 2.0f * (float)dsp::kPi * rng.uniform();
+    return Vec3(r * std::cos(phi), r * std::sin(phi), z);
+}
+
+Vec3 cosineHemisphere(const Vec3& n, Random& rng) {
+    Vec3 t = std::fabs(n.x) > 0.5f ? Vec3(0.0f, 1.0f, 0.0f) : Vec3(1.0f, 0.0f, 0.0f);
+    Vec3 b1 = normalize(cross(n, t));
+    Vec3 b2 = cross(n, b1);
+    float u = rng.uniform();
+    float phi = 2.0f * (float)dsp::kPi * rng.uniform();
+    float r = std::sqrt(u);
+    return normalize(b1 * (r * std::cos(phi)) + b2 * (r * std::sin(phi)) + n * std::sqrt(1.0f - u));
+}
+
+} // namespace
+
+Tracer::Tracer(const BVH& b, const float* r, const float* t,
+               const TraceSettings& s, ThreadPool& p)
+    : bvh(b), reflection(r), transmission(t), settings(s), pool(p) {
+    settings.forward = normalize(settings.forward);
+    settings.up = normalize(settings.up);
+    right = normalize(cross(settings.forward, settings.up));
+    filterLength = std::max(1, (int)std::ceil(settings.reverbLength * settings.sampleRate));
+    binSamples = std::max(1, settings.sampleRate / 1000);
+    numBins = (filterLength + binSamples - 1) / binSamples;
+    workerEnergy.resize(pool.getThreadCount());
+}
+
+void Tracer::trace(const TraceSource& source, TraceHistory& history, TraceResult& result) {
+    result.length = filterLength;
+    traceDirect(source, result);
+    traceIndirect(source, history, result);
+}
+
+void Tracer::traceDirect(const TraceSource& source, TraceResult& result) {
+    DirectPath& direct = result.direct;
+    Vec3 toListener = settings.listener - source.location;
+    float units = length(toListener);
+    direct.sourceToListener = toListener * (1.0f / settings.unitLength);
+    direct.distance = units / settings.unitLength;
+    direct.occlusion = bvh.transmittance(source.location, settings.listener, transmission);
+    direct.distanceAttenuation = 1.0f / std::fmax(direct.distance, 1.0f);
+
+    Vec3 arrival = normalize(source.location - settings.listener);
+    float side = dot(arrival, right);
+    float front = dot(arrival, settings.forward);
+    float above = std::fmax(-1.0f, std::fmin(1.0f, dot(arrival, settings.up)));
+    direct.azimuth = std::atan2(side, front) * (180.0f / (float)dsp::kPi);
+    direct.elevation = std::asin(above) * (180.0f / (float)dsp::kPi);
+
+    float delay = direct.distance / kSpeedOfSound * settings.sampleRate;
+    float lateral = std::fabs(side);
+    float itd = kHeadRadius / kSpeedOfSound * (std::asin(std::fmin(lateral, 1.0f)) + lateral) * settings.sampleRate;
+    result.directDelay[0] = delay + (side > 0.0f ? itd : 0.0f);
+    result.directDelay[1] = delay + (side < 0.0f ? itd : 0.0f);
+
+    float gain = direct.occlusion * direct.distanceAttenuation;
+    result.directGain[0] = gain * std::sqrt(1.0f - kPanDepth * side);
+    result.directGain[1] = gain * std::sqrt(1.0f + kPanDepth * side);
+}
+
+void Tracer::traceIndirect(const TraceSource& source, TraceHistory& history, TraceResult& result) {
+    int effect = std::max(0, std::min((int)source.effect, NVAR_NUM_EFFECT_PRESETS - 1));
+    int rays = std::max(1, (int)(kEffectRays[effect] * computeScale(settings.preset)));
+    int bounces = kEffectBounces[effect];
+    float unitLength = settings.unitLength;
+    float maxPath = settings.reverbLength * kSpeedOfSound * unitLength;
+    float offset = 1e-3f * unitLength;
+    float rayEnergy = 1.0f / rays;
+    float samplesPerUnit = settings.sampleRate / (kSpeedOfSound * unitLength);
+    uint64_t raySeed = source.seed ^ (source.traceIndex * 0x9E3779B97F4A7C15ull);
+
+    for (size_t w = 0; w < workerEnergy.size(); w++) {
+        workerEnergy[w].assign((size_t)numBins * kChannels, 0.0f);
+    }
+
+    if (!bvh.empty()) {
+        pool.parallelFor(rays, 64, [&](int begin, int end, int worker) {
+            float* energy = workerEnergy[worker].data();
+            for (int i = begin; i < end; i++) {
+                Random rng(raySeed ^ ((uint64_t)i * 0xD1B54A32D192ED03ull));
+                Vec3 origin = source.location;
+                Vec3 dir = uniformSphere(rng);
+                float travelled = 0.0f;
+                float e = rayEnergy;
+
+                for (int b = 0; b < bounces; b++) {
+                    Hit hit;
+                    if (!bvh.intersect(origin, dir, maxPath - travelled, hit)) {
+                        break;
+                    }
+                    travelled += hit.t;
+                    Vec3 p = origin + dir * hit.t;
+                    Vec3 n = dot(hit.normal, dir) > 0.0f ? -hit.normal : hit.normal;
+                    int material = bvh.getTriangle(hit.triangle).material;
+                    float r = reflection[material];
+                    float t = transmission[material];
+
+                    // diffuse rain: connect this reflection to the listener
+                    Vec3 toListener = settings.listener - p;
+                    float d = length(toListener);
+                    float cosOut = d > 0.0f ? dot(n, toListener) / d : 0.0f;
+                    if (r > 0.0f && cosOut > 0.0f) {
+                        int bin = (int)((travelled + d) * samplesPerUnit) / binSamples;
+                        if (bin < numBins) {
+                            float visible = bvh.transmittance(p + n * offset, settings.listener, transmission);
+                            if (visible > 0.0f) {
+                                float meters = std::fmax(d / unitLength, 1.0f);
+                                float received = 4.0f * e * r * cosOut * visible / (meters * meters);
+                                float side = dot(normalize(p - settings.listener), right);
+                                energy[bin * kChannels] += received * (1.0f - kPanDepth * side);
+                                energy[bin * kChannels + 1] += received * (1.0f + kPanDepth * side);
+                            }
+                        }
+                    }
+
+                    float total = r + t;
+                    if (total <= 0.0f) {
+                        break;
+                    }
+                    e *= total;
+                    if (e < rayEnergy * 1e-6f) {
+                        break;
+                    }
+                    if (rng.uniform() * total < r) {
+                        dir = cosineHemisphere(n, rng);
+                        origin = p + n * offset;
+                    } else {
+                        origin = p - n * offset;
+                    }
+                }
+            }
+        });
+    }
+
+    // reduce worker histograms and smooth against the previous trace
+    std::vector<float> energy((size_t)numBins * kChannels, 0.0f);
+    for (size_t w = 0; w < workerEnergy.size(); w++) {
+        for (size_t i = 0; i < energy.size(); i++) {
+            energy[i] += workerEnergy[w][i];
+        }
+    }
+    for (int ch = 0; ch < kChannels; ch++) {
+        std::vector<float>& previous = history.energy[ch];
+        bool smooth = previous.size() == (size_t)numBins;
+        if (!smooth) {
+            previous.assign(numBins, 0.0f);
+        }
+        for (int bin = 0; bin < numBins; bin++) {
+            float value = energy[bin * kChannels + ch];
+            if (smooth) {
+                // earlier energy fades as (1 - decayFactor)^N; 1.0 keeps only the latest trace
+                value = (1.0f - settings.decayFactor) * previous[bin] + settings.decayFactor * value;
+            }
+            previous[bin] = value;
+        }
+    }
+
+    // shape a fixed noise sequence per ear by the energy envelope, so
+    // successive traces only change the envelope and not the fine structure
+    for (int ch = 0; ch < kChannels; ch++) {
+        std::vector<float>& filter = result.indirect[ch];
+        filter.assign(filterLength, 0.0f);
+        const std::vector<float>& envelope = history.energy[ch];
+        Random noise(source.seed * 31 + ch + 1);
+        const float unitVariance = std::sqrt(3.0f);
+        for (int n = 0; n < filterLength; n++) {
+            float amplitude = std::sqrt(envelope[n / binSamples] / binSamples);
+            filter[n] = amplitude * unitVariance * (2.0f * noise.uniform() - 1.0f);
+        }
+    }
+}
+
+} // namespace nvarcpu
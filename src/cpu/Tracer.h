@@ -0,0 +1,93 @@
+#ifndef GODOTNVAR_CPU_TRACER_H
+#define GODOTNVAR_CPU_TRACER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "BVH.h"
+#include "ThreadPool.h"
+
+namespace nvarcpu {
+
+/** Number of output channels produced by the tracer (stereo headphones) **/
+const int kChannels = 2;
+
+/** Speed of sound in meters per second **/
+const float kSpeedOfSound = 343.0f;
+
+/** Context-wide trace parameters, copied when a trace starts **/
+struct TraceSettings {
+    float reverbLength;
+    int sampleRate;
+    float decayFactor;
+    float unitLength;       // geometry units per meter
+    nvarPreset_t preset;
+    Vec3 listener;
+    Vec3 forward;
+    Vec3 up;
+};
+
+/** Per-source trace input **/
+struct TraceSource {
+    Vec3 location;
+    nvarEffect_t effect;
+    uint64_t seed;          // fixed per source, shapes the filter noise
+    uint64_t traceIndex;    // varies the ray directions between traces
+};
+
+/** Geometric direct path data, as reported by nvarGetSourceDetails **/
+struct DirectPath {
+    Vec3 sourceToListener;  // meters
+    float distance;         // meters
+    float azimuth;          // degrees
+    float elevation;        // degrees
+    float occlusion;        // transmission along the direct path, 1.0 is unoccluded
+    float distanceAttenuation;
+};
+
+/** Trace output for one source **/
+struct TraceResult {
+    DirectPath direct;
+    float directDelay[kChannels];   // samples
+    float directGain[kChannels];
+    int length;                     // filter taps per channel
+    std::vector<float> indirect[kChannels];
+};
+
+/** Per-source state the tracer keeps between traces **/
+struct TraceHistory {
+    std::vector<float> energy[kChannels];
+};
+
+/** Energy-histogram acoustic tracer. Rays are emitted from the source,
+ *  bounced diffusely off the committed geometry and connected to the
+ *  listener at every bounce. The resulting energy envelope is turned into
+ *  a decorrelated noise filter per ear; the direct path is returned as a
+ *  delay and gain pair so it can be rendered exactly.
+ */
+class Tracer {
+public:
+    Tracer(const BVH& bvh, const float* reflection, const float* transmission,
+           const TraceSettings& settings, ThreadPool& pool);
+
+    void trace(const TraceSource& source, TraceHistory& history, TraceResult& result);
+
+private:
+    void traceDirect(const TraceSource& source, TraceResult& result);
+    void traceIndirect(const TraceSource& source, TraceHistory& history, TraceResult& result);
+
+    const BVH& bvh;
+    const float* reflection;
+    const float* transmission;
+    TraceSettings settings;
+    ThreadPool& pool;
+    Vec3 right;
+    int filterLength;
+    int binSamples;
+    int numBins;
+    std::vector<std::vector<float> > workerEnergy;
+};
+
+} // namespace nvarcpu
+
+#endif // GODOTNVAR_CPU_TRACER_H
@@ -0,0 +1,1609 @@
+#include "nvarCPU.h"
+#include "nvarNDA.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "BVH.h"
+#include "SourceRenderer.h"
+#include "ThreadPool.h"
+#include "Tracer.h"
+
+using namespace nvarcpu;
+
+namespace {
+
+const uint32_t kContextMagic = 0x4E564152;
+const uint32_t kMaterialMagic = 0x4D41544C;
+const uint32_t kMeshMagic = 0x4D455348;
+const uint32_t kSourceMagic = 0x53524345;
+const uint32_t kEventMagic = 0x45564E54;
+const uint32_t kDeadMagic = 0;
+
+/** Upper bound on sources submitted between two batched indirect mixes **/
+const int kMaxSubmittedSources = 4096;
+
+const char* kDeviceName = "CPU reference";
+
+struct Event {
+    uint32_t magic;
+    std::mutex lock;
+    std::condition_variable cv;
+    bool signaled;
+};
+
+struct Command {
+    bool trace;
+    Event* event;
+};
+
+/** Immutable snapshot of the committed geometry **/
+struct Scene {
+    BVH bvh;
+    std::vector<nvarMaterial_t> materials;
+    std::vector<float> reflection;      // values at commit time, used if a material is destroyed later
+    std::vector<float> transmission;
+};
+
+struct PredefinedMaterial {
+    float reflection;
+    float transmission;
+};
+
+const PredefinedMaterial kPredefinedMaterials[NUM_NVAR_PREDEFINED_MATERIALS] = {
+    { 0.90f, 0.00f },   // concrete
+    { 0.95f, 0.00f },   // metal
+    { 0.80f, 0.02f },   // plastic
+    { 0.30f, 0.01f },   // carpet
+    { 0.85f, 0.10f },   // glass
+    { 0.70f, 0.05f },   // wood
+    { 0.40f, 0.20f },   // cloth
+    { 0.00f, 0.00f },   // absorber
+};
+
+const char* kStatusStrings[NUM_NVAR_STATUS_CODES] = {
+    "NVAR_STATUS_SUCCESS",
+    "NVAR_STATUS_NOT_INITIALIZED",
+    "NVAR_STATUS_NOT_SUPPORTED",
+    "NVAR_STATUS_NOT_IMPLEMENTED",
+    "NVAR_STATUS_INVALID_VALUE",
+    "NVAR_STATUS_OUT_OF_RESOURCES",
+    "NVAR_STATUS_NOT_READY",
+    "NVAR_STATUS_ERROR",
+};
+
+const char* kStatusDescriptions[NUM_NVAR_STATUS_CODES] = {
+    "No error has occurred.",
+    "The API has not been initialized.",
+    "The operation is not supported due to a mismatch between the operation requested and the state of one or more objects.",
+    "The operation is not implemented.",
+    "A parameter value is invalid.",
+    "An internal resource allocation has failed.",
+    "The operation is not available at this time.",
+    "A generic error has occurred.",
+};
+
+std::mutex g_lock;
+std::atomic<bool> g_initialized(false);
+int g_flags = 0;
+nvar_t g_unnamed = nullptr;
+nvar_t g_named = nullptr;
+
+} // namespace
+
+struct nvarMaterial_st {
+    uint32_t magic;
+    nvar_t nvar;
+    float reflection;
+    float transmission;
+    int meshRefs;
+};
+
+struct nvarMesh_st {
+    uint32_t magic;
+    nvar_t nvar;
+    nvarMatrix4x4_t transform;
+    std::vector<Vec3> vertices;
+    std::vector<int> faces;
+    nvarMaterial_t material;
+};
+
+struct nvarSource_st {
+    uint32_t magic;
+    nvar_t nvar;
+    Vec3 location;
+    nvarEffect_t effect;
+    uint64_t seed;
+    std::atomic<float> directPathGain;
+    std::atomic<float> indirectPathGain;
+
+    // trace side, owned by the context worker and guarded by the context lock
+    TraceHistory history;
+    std::vector<SourceFilters*> owned;
+    SourceFilters* latest;
+
+    // handoff to the audio thread, see acquireFilters()
+    std::atomic<SourceFilters*> pending;
+    std::atomic<SourceFilters*> inUse;
+    std::atomic<SourceFilters*> claiming;
+    std::atomic<int> partitionSize;
+
+    // audio side
+    SourceFilters* active;
+    DirectRenderer directRenderer;
+    IndirectRenderer indirectRenderer;
+    std::vector<float> submitBuffer;
+    int submitSamples;
+
+    ~nvarSource_st() {
+        for (size_t i = 0; i < owned.size(); i++) {
+            delete owned[i];
+        }
+    }
+};
+
+/** Frequency-domain accumulator shared by every submitted source, so the
+ *  batched indirect mix needs one inverse FFT per channel instead of one
+ *  per source and channel.
+ */
+struct SpectrumMix {
+    int partitionSize = 0;
+    dsp::RealFFT fft;
+    std::vector<float> re[kChannels];
+    std::vector<float> im[kChannels];
+    std::vector<float> time;
+
+    void prepare(int pSize) {
+        if (partitionSize == pSize) {
+            return;
+        }
+        partitionSize = pSize;
+        fft.init(2 * pSize);
+        for (int ch = 0; ch < kChannels; ch++) {
+            re[ch].assign(pSize + 1, 0.0f);
+            im[ch].assign(pSize + 1, 0.0f);
+        }
+        time.assign(2 * pSize, 0.0f);
+    }
+
+    void clear() {
+        for (int ch = 0; ch < kChannels; ch++) {
+            std::fill(re[ch].begin(), re[ch].end(), 0.0f);
+            std::fill(im[ch].begin(), im[ch].end(), 0.0f);
+        }
+    }
+
+    /** Adds the valid half of each channel's inverse transform to pOut **/
+    void inverse(float** pOut) {
+        for (int ch = 0; ch < kChannels; ch++) {
+            fft.inverse(re[ch].data(), im[ch].data(), time.data());
+            const float* valid = time.data() + partitionSize;
+            for (int i = 0; i < partitionSize; i++) {
+                pOut[ch][i] += valid[i];
+            }
+        }
+    }
+};
+
+struct nvar_st {
+    uint32_t magic;
+    std::string name;
+    int refCount;
+    int device;
+    nvarPreset_t preset;
+
+    std::mutex lock;
+    float reverbLength;
+    int sampleRate;
+    nvarOutputFormat_t outputFormat;
+    float decayFactor;
+    float unitLength;
+    Vec3 listener;
+    Vec3 forward;
+    Vec3 up;
+
+    std::unordered_set<nvarMaterial_t> materials;
+    std::vector<nvarMesh_t> meshes;
+    std::vector<nvarSource_t> sources;
+    std::unordered_set<nvarSource_t> liveSources;
+    std::vector<nvarSource_t> graveyard;
+    uint64_t nextSourceSeed;
+
+    std::mutex commitLock;
+    bool geometryDirty;
+    std::shared_ptr<const Scene> scene;
+
+    // asynchronous command queue
+    std::thread worker;
+    std::condition_variable queueWake;
+    std::condition_variable queueIdle;
+    std::deque<Command> queue;
+    bool busy;
+    bool stopping;
+    uint64_t traceCount;
+    int threadCount;
+    std::unique_ptr<ThreadPool> pool;
+    std::unordered_map<int, std::unique_ptr<dsp::RealFFT> > spectrumFFTs;
+
+    // batched indirect mixing, written from the audio thread only
+    std::atomic<int> submitCount;
+    std::vector<nvarSource_t> submitted;
+    SpectrumMix submitMix;
+};
+
+namespace {
+
+bool validContext(nvar_t nvar) {
+    return nvar != nullptr && nvar->magic == kContextMagic;
+}
+
+bool validMaterial(nvarMaterial_t material) {
+    return material != nullptr && material->magic == kMaterialMagic;
+}
+
+bool validMesh(nvarMesh_t mesh) {
+    return mesh != nullptr && mesh->magic == kMeshMagic;
+}
+
+bool validSource(nvarSource_t source) {
+    return source != nullptr && source->magic == kSourceMagic;
+}
+
+bool validEvent(HANDLE handle) {
+    Event* event = static_cast<Event*>(handle);
+    return event != nullptr && event->magic == kEventMagic;
+}
+
+void signalEvent(Event* event) {
+    {
+        std::lock_guard<std::mutex> guard(event->lock);
+        event->signaled = true;
+    }
+    event->cv.notify_all();
+}
+
+int filterLength(nvar_t nvar) {
+    return std::max(1, (int)std::ceil(nvar->reverbLength * nvar->sampleRate));
+}
+
+/** Rebuilds the BVH from the current meshes. The mesh data is copied under
+ *  the context lock, the hierarchy is built without it.
+ */
+void commit(nvar_t nvar) {
+    std::lock_guard<std::mutex> commitGuard(nvar->commitLock);
+    std::shared_ptr<Scene> scene = std::make_shared<Scene>();
+    std::vector<Triangle> triangles;
+    {
+        std::lock_guard<std::mutex> guard(nvar->lock);
+        std::unordered_map<nvarMaterial_t, int> materialIndex;
+        size_t total = 0;
+        for (size_t m = 0; m < nvar->meshes.size(); m++) {
+            total += nvar->meshes[m]->faces.size() / 3;
+        }
+        triangles.reserve(total);
+
+        std::vector<Vec3> world;
+        for (size_t m = 0; m < nvar->meshes.size(); m++) {
+            nvarMesh_t mesh = nvar->meshes[m];
+            std::unordered_map<nvarMaterial_t, int>::iterator it = materialIndex.find(mesh->material);
+            int material;
+            if (it == materialIndex.end()) {
+                material = (int)scene->materials.size();
+                materialIndex[mesh->material] = material;
+                scene->materials.push_back(mesh->material);
+                scene->reflection.push_back(mesh->material->reflection);
+                scene->transmission.push_back(mesh->material->transmission);
+            } else {
+                material = it->second;
+            }
+
+            world.resize(mesh->vertices.size());
+            for (size_t v = 0; v < mesh->vertices.size(); v++) {
+                world[v] = transformPoint(mesh->transform, mesh->vertices[v]);
+            }
+            for (size_t f = 0; f + 2 < mesh->faces.size(); f += 3) {
+                Triangle tri;
+                tri.v0 = world[mesh->faces[f]];
+                tri.e1 = world[mesh->faces[f + 1]] - tri.v0;
+                tri.e2 = world[mesh->faces[f + 2]] - tri.v0;
+                tri.material = material;
+                triangles.push_back(tri);
+            }
+        }
+        nvar->geometryDirty = false;
+    }
+
+    scene->bvh.build(std::move(triangles));
+
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    nvar->scene = scene;
+}
+
+/** Hands a new filter set to the audio thread and frees the ones it can no
+ *  longer see. Called with the context lock held.
+ */
+void publishFilters(nvarSource_t source, SourceFilters* filters) {
+    source->owned.push_back(filters);
+    source->latest = filters;
+    source->pending.store(filters);
+
+    SourceFilters* pending = source->pending.load();
+    SourceFilters* inUse = source->inUse.load();
+    SourceFilters* claiming = source->claiming.load();
+    for (size_t i = 0; i < source->owned.size();) {
+        SourceFilters* f = source->owned[i];
+        if (f != source->latest && f != pending && f != inUse && f != claiming) {
+            delete f;
+            source->owned[i] = source->owned.back();
+            source->owned.pop_back();
+        } else {
+            i++;
+        }
+    }
+}
+
+/** Audio-thread side of the handoff, lock and allocation free. The inUse and
+ *  claiming slots act as hazard pointers: a filter is announced in claiming
+ *  before it is re-checked against pending, so the worker can never free it
+ *  between the load and the claim, and the active filter stays announced in
+ *  inUse until the new one replaces it.
+ */
+const SourceFilters* acquireFilters(nvarSource_t source) {
+    SourceFilters* next = source->pending.load();
+    if (next != nullptr && next != source->active) {
+        source->claiming.store(next);
+        if (source->pending.load() == next) {
+            source->active = next;
+            source->inUse.store(next);
+        }
+        source->claiming.store(nullptr);
+    }
+    return source->active;
+}
+
+void runTrace(nvar_t nvar) {
+    bool dirty;
+    {
+        std::lock_guard<std::mutex> guard(nvar->lock);
+        dirty = nvar->geometryDirty || !nvar->scene;
+    }
+    if (dirty) {
+        commit(nvar);
+    }
+
+    struct Job {
+        nvarSource_t source;
+        TraceSource input;
+        int partitionSize;
+    };
+    std::vector<Job> jobs;
+    TraceSettings settings;
+    std::shared_ptr<const Scene> scene;
+    std::vector<float> reflection;
+    std::vector<float> transmission;
+    int threads;
+    {
+        std::lock_guard<std::mutex> guard(nvar->lock);
+        settings.reverbLength = nvar->reverbLength;
+        settings.sampleRate = nvar->sampleRate;
+        settings.decayFactor = nvar->decayFactor;
+        settings.unitLength = nvar->unitLength;
+        settings.preset = nvar->preset;
+        settings.listener = nvar->listener;
+        settings.forward = nvar->forward;
+        settings.up = nvar->up;
+        scene = nvar->scene;
+        threads = nvar->threadCount;
+        uint64_t traceIndex = ++nvar->traceCount;
+
+        reflection = scene->reflection;
+        transmission = scene->transmission;
+        for (size_t m = 0; m < scene->materials.size(); m++) {
+            nvarMaterial_t material = scene->materials[m];
+            if (nvar->materials.count(material) > 0) {
+                reflection[m] = material->reflection;
+                transmission[m] = material->transmission;
+            }
+        }
+
+        jobs.reserve(nvar->sources.size());
+        for (size_t i = 0; i < nvar->sources.size(); i++) {
+            nvarSource_t source = nvar->sources[i];
+            Job job;
+            job.source = source;
+            job.input.location = source->location;
+            job.input.effect = source->effect;
+            job.input.seed = source->seed;
+            job.input.traceIndex = traceIndex;
+            job.partitionSize = source->partitionSize.load();
+            jobs.push_back(job);
+        }
+    }
+
+    if (!nvar->pool || (threads > 0 && nvar->pool->getThreadCount() != threads)) {
+        nvar->pool.reset(new ThreadPool(threads));
+    }
+
+    Tracer tracer(scene->bvh, reflection.data(), transmission.data(), settings, *nvar->pool);
+    std::vector<SourceFilters*> results(jobs.size());
+    for (size_t i = 0; i < jobs.size(); i++) {
+        TraceResult result;
+        tracer.trace(jobs[i].input, jobs[i].source->history, result);
+
+        SourceFilters* filters = new SourceFilters();
+        filters->length = result.length;
+        filters->sampleRate = settings.sampleRate;
+        filters->direct = result.direct;
+        for (int ch = 0; ch < kChannels; ch++) {
+            filters->directDelay[ch] = result.directDelay[ch];
+            filters->directGain[ch] = result.directGain[ch];
+            filters->indirect[ch].swap(result.indirect[ch]);
+        }
+
+        // prebuild spectra for the block size the audio thread is using
+        int partitionSize = jobs[i].partitionSize;
+        if (partitionSize > 0) {
+            std::unique_ptr<dsp::RealFFT>& fft = nvar->spectrumFFTs[partitionSize];
+            if (!fft) {
+                fft.reset(new dsp::RealFFT(2 * partitionSize));
+            }
+            for (int ch = 0; ch < kChannels; ch++) {
+                filters->spectrum[ch].build(*fft, filters->indirect[ch].data(), filters->length, partitionSize);
+            }
+        }
+        results[i] = filters;
+    }
+
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    for (size_t i = 0; i < jobs.size(); i++) {
+        if (nvar->liveSources.count(jobs[i].source) > 0) {
+            publishFilters(jobs[i].source, results[i]);
+        } else {
+            delete results[i];
+        }
+    }
+}
+
+void workerLoop(nvar_t nvar) {
+    std::unique_lock<std::mutex> guard(nvar->lock);
+    for (;;) {
+        nvar->queueWake.wait(guard, [nvar] { return nvar->stopping || !nvar->queue.empty(); });
+        if (nvar->stopping) {
+            break;
+        }
+        Command command = nvar->queue.front();
+        nvar->queue.pop_front();
+        nvar->busy = true;
+        guard.unlock();
+
+        if (command.trace) {
+            runTrace(nvar);
+        }
+        if (command.event != nullptr) {
+            signalEvent(command.event);
+        }
+
+        guard.lock();
+        nvar->busy = false;
+        for (size_t i = 0; i < nvar->graveyard.size(); i++) {
+            delete nvar->graveyard[i];
+        }
+        nvar->graveyard.clear();
+        if (nvar->queue.empty()) {
+            nvar->queueIdle.notify_all();
+        }
+    }
+    nvar->busy = false;
+    nvar->queueIdle.notify_all();
+}
+
+nvarStatus_t enqueue(nvar_t nvar, bool trace, HANDLE hEvent) {
+    if (hEvent != nullptr && !validEvent(hEvent)) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    Command command;
+    command.trace = trace;
+    command.event = static_cast<Event*>(hEvent);
+    {
+        std::lock_guard<std::mutex> guard(nvar->lock);
+        nvar->queue.push_back(command);
+    }
+    nvar->queueWake.notify_one();
+    return NVAR_STATUS_SUCCESS;
+}
+
+void shutdownContext(nvar_t nvar) {
+    {
+        std::lock_guard<std::mutex> guard(nvar->lock);
+        nvar->stopping = true;
+        nvar->queue.clear();
+    }
+    nvar->queueWake.notify_all();
+    nvar->worker.join();
+
+    for (size_t i = 0; i < nvar->sources.size(); i++) {
+        nvar->sources[i]->magic = kDeadMagic;
+        delete nvar->sources[i];
+    }
+    for (size_t i = 0; i < nvar->graveyard.size(); i++) {
+        delete nvar->graveyard[i];
+    }
+    for (size_t i = 0; i < nvar->meshes.size(); i++) {
+        nvar->meshes[i]->magic = kDeadMagic;
+        delete nvar->meshes[i];
+    }
+    for (std::unordered_set<nvarMaterial_t>::iterator it = nvar->materials.begin(); it != nvar->materials.end(); ++it) {
+        (*it)->magic = kDeadMagic;
+        delete *it;
+    }
+    nvar->magic = kDeadMagic;
+    delete nvar;
+}
+
+/** Shared body of the three per-source apply functions **/
+nvarStatus_t applyFilters(nvarSource_t source, float** pOut, const float* pIn, const int numSamples,
+                          bool direct, bool indirect) {
+    if (!g_initialized.load()) {
+        return NVAR_STATUS_NOT_INITIALIZED;
+    }
+    if (!validSource(source) || numSamples <= 0) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    if (pOut == nullptr && pIn == nullptr) {
+        // preallocation call
+        int length = std::max(1, (int)std::ceil(source->nvar->reverbLength * source->nvar->sampleRate));
+        source->directRenderer.prepare(numSamples, length);
+        source->indirectRenderer.prepare(numSamples, length);
+        source->partitionSize.store(source->indirectRenderer.getPartitionSize());
+        if ((int)source->submitBuffer.size() < numSamples) {
+            source->submitBuffer.resize(numSamples);
+        }
+        return NVAR_STATUS_SUCCESS;
+    }
+    if (pOut == nullptr || pIn == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    for (int ch = 0; ch < kChannels; ch++) {
+        if (pOut[ch] == nullptr) {
+            return NVAR_STATUS_INVALID_VALUE;
+        }
+    }
+
+    const SourceFilters* filters = acquireFilters(source);
+    bool written = false;
+    if (direct) {
+        source->directRenderer.process(filters, source->directPathGain.load(), pIn, numSamples, pOut, false);
+        written = true;
+    }
+    if (indirect) {
+        source->indirectRenderer.process(filters, source->indirectPathGain.load(), pIn, numSamples, pOut, written);
+        source->partitionSize.store(source->indirectRenderer.getPartitionSize());
+    }
+    return NVAR_STATUS_SUCCESS;
+}
+
+} // namespace
+
+#define NVAR_CHECK_INITIALIZED() \
+    if (!g_initialized.load()) { return NVAR_STATUS_NOT_INITIALIZED; }
+
+extern "C" {
+
+nvarStatus_t NVAR_API
+nvarGetStatusString(const char** pStr, const nvarStatus_t status) {
+    if (pStr == nullptr || status < 0 || status >= NUM_NVAR_STATUS_CODES) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    *pStr = kStatusStrings[status];
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetStatusDescription(const char** pStr, const nvarStatus_t status) {
+    if (pStr == nullptr || status < 0 || status >= NUM_NVAR_STATUS_CODES) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    *pStr = kStatusDescriptions[status];
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetVersion(int* pVersion) {
+    if (pVersion == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    *pVersion = NVAR_API_VERSION;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetOutputFormatChannels(nvarOutputFormat_t outputFormat, int* pChannels) {
+    if (pChannels == nullptr || outputFormat != NVAR_OUTPUT_FORMAT_STEREO_HEADPHONES) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    *pChannels = kChannels;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarInitialize(const int flags) {
+    if (flags != 0) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(g_lock);
+    g_flags = flags;
+    g_initialized.store(true);
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarFinalize(void) {
+    NVAR_CHECK_INITIALIZED();
+    nvar_t contexts[2];
+    {
+        std::lock_guard<std::mutex> guard(g_lock);
+        contexts[0] = g_unnamed;
+        contexts[1] = g_named;
+        g_unnamed = nullptr;
+        g_named = nullptr;
+        g_initialized.store(false);
+    }
+    for (int i = 0; i < 2; i++) {
+        if (contexts[i] != nullptr) {
+            shutdownContext(contexts[i]);
+        }
+    }
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetInitializeFlags(int* pFlags) {
+    NVAR_CHECK_INITIALIZED();
+    if (pFlags == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    *pFlags = g_flags;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetDeviceCount(int* pDeviceCount) {
+    NVAR_CHECK_INITIALIZED();
+    if (pDeviceCount == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    *pDeviceCount = 1;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetDevices(int* pDevices, int* pDeviceCount) {
+    NVAR_CHECK_INITIALIZED();
+    if (pDevices == nullptr || pDeviceCount == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    if (*pDeviceCount > 0) {
+        pDevices[0] = 0;
+        *pDeviceCount = 1;
+    }
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetDeviceName(int device, char* name, int length) {
+    NVAR_CHECK_INITIALIZED();
+    if (device != 0 || name == nullptr || length <= 0) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::strncpy(name, kDeviceName, length - 1);
+    name[length - 1] = '\0';
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetPreferedDevice(void* pDXGIAdapter, int* pDevice) {
+    NVAR_CHECK_INITIALIZED();
+    (void)pDXGIAdapter;
+    if (pDevice == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    *pDevice = 0;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarCreate(nvar_t* pNvar, const char name[], const size_t nameLength,
+           nvarPreset_t preset, int* pDeviceNum) {
+    NVAR_CHECK_INITIALIZED();
+    if (pNvar == nullptr || preset < 0 || preset >= NVAR_NUM_COMPUTE_PRESETS) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    int device = pDeviceNum != nullptr ? *pDeviceNum : 0;
+    std::string contextName;
+    if (name != nullptr) {
+        size_t limit = std::min(nameLength, (size_t)NVAR_CREATE_NAME_LENGTH);
+        contextName.assign(name, strnlen(name, limit));
+    }
+
+    std::lock_guard<std::mutex> guard(g_lock);
+    nvar_t& slot = contextName.empty() ? g_unnamed : g_named;
+    if (slot != nullptr) {
+        if (slot->name != contextName) {
+            return NVAR_STATUS_OUT_OF_RESOURCES;
+        }
+        if (slot->device != device) {
+            if (pDeviceNum != nullptr) {
+                *pDeviceNum = slot->device;
+            }
+            return NVAR_STATUS_NOT_SUPPORTED;
+        }
+        slot->refCount++;
+        *pNvar = slot;
+        return NVAR_STATUS_SUCCESS;
+    }
+    if (device != 0) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+
+    nvar_t nvar = new nvar_st();
+    nvar->magic = kContextMagic;
+    nvar->name = contextName;
+    nvar->refCount = 1;
+    nvar->device = device;
+    nvar->preset = preset;
+    nvar->reverbLength = NVAR_DEFAULT_REVERB_LENGTH;
+    nvar->sampleRate = NVAR_DEFAULT_SAMPLE_RATE;
+    nvar->outputFormat = NVAR_DEFAULT_OUTPUT_FORMAT;
+    nvar->decayFactor = NVAR_DEFAULT_DECAY_FACTOR;
+    nvar->unitLength = NVAR_DEFAULT_UNIT_LENGTH_PER_METER_RATIO;
+    nvar->listener = Vec3(0.0f, 0.0f, 0.0f);
+    nvar->forward = Vec3(0.0f, 0.0f, -1.0f);
+    nvar->up = Vec3(0.0f, 1.0f, 0.0f);
+    nvar->nextSourceSeed = 1;
+    nvar->geometryDirty = true;
+    nvar->busy = false;
+    nvar->stopping = false;
+    nvar->traceCount = 0;
+    nvar->threadCount = 0;
+    nvar->submitCount.store(0);
+    nvar->submitted.resize(kMaxSubmittedSources);
+    nvar->worker = std::thread(workerLoop, nvar);
+
+    slot = nvar;
+    *pNvar = nvar;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarDestroy(nvar_t nvar) {
+    NVAR_CHECK_INITIALIZED();
+    {
+        std::lock_guard<std::mutex> guard(g_lock);
+        if (!validContext(nvar)) {
+            return NVAR_STATUS_INVALID_VALUE;
+        }
+        if (--nvar->refCount > 0) {
+            return NVAR_STATUS_SUCCESS;
+        }
+        if (g_unnamed == nvar) {
+            g_unnamed = nullptr;
+        }
+        if (g_named == nvar) {
+            g_named = nullptr;
+        }
+    }
+    shutdownContext(nvar);
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetDeviceNum(nvar_t nvar, int* pDeviceNum) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar) || pDeviceNum == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    *pDeviceNum = nvar->device;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetReverbLength(nvar_t nvar, float* pReverbLength) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar) || pReverbLength == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    *pReverbLength = nvar->reverbLength;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarSetReverbLength(nvar_t nvar, const float reverbLength) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar) || !(reverbLength > 0.0f)) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    nvar->reverbLength = reverbLength;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetSampleRate(nvar_t nvar, int* pSampleRate) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar) || pSampleRate == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    *pSampleRate = nvar->sampleRate;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarSetSampleRate(nvar_t nvar, const int sampleRate) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar) || sampleRate < NVAR_MIN_SAMPLE_RATE) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    nvar->sampleRate = sampleRate;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetOutputFormat(nvar_t nvar, nvarOutputFormat_t* pOutputFormat) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar) || pOutputFormat == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    *pOutputFormat = nvar->outputFormat;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarSetOutputFormat(nvar_t nvar, const nvarOutputFormat_t outputFormat) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar) || outputFormat != NVAR_OUTPUT_FORMAT_STEREO_HEADPHONES) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    nvar->outputFormat = outputFormat;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetDecayFactor(nvar_t nvar, float* pDecayFactor) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar) || pDecayFactor == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    *pDecayFactor = nvar->decayFactor;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarSetDecayFactor(nvar_t nvar, const float decayFactor) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar) || !(decayFactor > 0.0f && decayFactor <= 1.0f)) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    nvar->decayFactor = decayFactor;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetUnitLength(nvar_t nvar, float* pRatio) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar) || pRatio == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    *pRatio = nvar->unitLength;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarSetUnitLength(nvar_t nvar, const float ratio) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar) || !(ratio > 0.0f)) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    nvar->unitLength = ratio;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarCommitGeometry(nvar_t nvar) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar)) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    commit(nvar);
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarExportOBJs(nvar_t nvar, const char* objFileBaseName) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar) || objFileBaseName == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::string base(objFileBaseName);
+    FILE* obj = std::fopen((base + ".obj").c_str(), "w");
+    FILE* mtl = std::fopen((base + ".mtl").c_str(), "w");
+    if (obj == nullptr || mtl == nullptr) {
+        if (obj) std::fclose(obj);
+        if (mtl) std::fclose(mtl);
+        return NVAR_STATUS_ERROR;
+    }
+
+    std::string mtlName = base.substr(base.find_last_of("/\\") + 1) + ".mtl";
+    std::fprintf(obj, "mtllib %s\n", mtlName.c_str());
+
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    std::unordered_map<nvarMaterial_t, int> materialIndex;
+    for (std::unordered_set<nvarMaterial_t>::iterator it = nvar->materials.begin(); it != nvar->materials.end(); ++it) {
+        int index = (int)materialIndex.size();
+        materialIndex[*it] = index;
+        float r = (*it)->reflection;
+        std::fprintf(mtl, "newmtl material_%d\nKd %f %f %f\nd %f\n\n", index, r, r, r, 1.0f - (*it)->transmission);
+    }
+
+    int vertexBase = 1;
+    for (size_t m = 0; m < nvar->meshes.size(); m++) {
+        nvarMesh_t mesh = nvar->meshes[m];
+        std::fprintf(obj, "o mesh_%d\nusemtl material_%d\n", (int)m, materialIndex[mesh->material]);
+        for (size_t v = 0; v < mesh->vertices.size(); v++) {
+            Vec3 p = transformPoint(mesh->transform, mesh->vertices[v]);
+            std::fprintf(obj, "v %f %f %f\n", p.x, p.y, p.z);
+        }
+        for (size_t f = 0; f + 2 < mesh->faces.size(); f += 3) {
+            std::fprintf(obj, "f %d %d %d\n", mesh->faces[f] + vertexBase,
+                         mesh->faces[f + 1] + vertexBase, mesh->faces[f + 2] + vertexBase);
+        }
+        vertexBase += (int)mesh->vertices.size();
+    }
+    std::fclose(obj);
+    std::fclose(mtl);
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetListenerLocation(nvar_t nvar, nvarFloat3_t* pLocation) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar) || pLocation == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    *pLocation = nvar->listener.toNvar();
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarSetListenerLocation(nvar_t nvar, const nvarFloat3_t location) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar)) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    nvar->listener = Vec3(location);
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetListenerOrientation(nvar_t nvar, nvarFloat3_t* pForward, nvarFloat3_t* pUp) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar) || pForward == nullptr || pUp == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    *pForward = nvar->forward.toNvar();
+    *pUp = nvar->up.toNvar();
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarSetListenerOrientation(nvar_t nvar, const nvarFloat3_t forward, const nvarFloat3_t up) {
+    NVAR_CHECK_INITIALIZED();
+    Vec3 f(forward);
+    Vec3 u(up);
+    if (!validContext(nvar) || length(f) == 0.0f || length(u) == 0.0f || length(cross(f, u)) == 0.0f) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    nvar->forward = f;
+    nvar->up = u;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarTraceAudio(nvar_t nvar, HANDLE traceDoneEvent) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar)) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    return enqueue(nvar, true, traceDoneEvent);
+}
+
+nvarStatus_t NVAR_API
+nvarEventRecord(nvar_t nvar, HANDLE hEvent) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar) || hEvent == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    return enqueue(nvar, false, hEvent);
+}
+
+nvarStatus_t NVAR_API
+nvarSynchronize(nvar_t nvar) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar)) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::unique_lock<std::mutex> guard(nvar->lock);
+    nvar->queueIdle.wait(guard, [nvar] { return nvar->queue.empty() && !nvar->busy; });
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarCreateMaterial(nvar_t nvar, nvarMaterial_t* pMaterial) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar) || pMaterial == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    nvarMaterial_t material = new nvarMaterial_st();
+    material->magic = kMaterialMagic;
+    material->nvar = nvar;
+    material->reflection = NVAR_DEFAULT_REFLECTION_COEFFICIENT;
+    material->transmission = NVAR_DEFAULT_TRANSMISSION_COEFFICIENT;
+    material->meshRefs = 0;
+
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    nvar->materials.insert(material);
+    *pMaterial = material;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarCreatePredefinedMaterial(nvar_t nvar, nvarMaterial_t* pMaterial,
+                             const nvarPredefinedMaterial_t predefinedMaterial) {
+    NVAR_CHECK_INITIALIZED();
+    if (predefinedMaterial < 0 || predefinedMaterial >= NUM_NVAR_PREDEFINED_MATERIALS) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    nvarStatus_t status = nvarCreateMaterial(nvar, pMaterial);
+    if (status != NVAR_STATUS_SUCCESS) {
+        return status;
+    }
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    (*pMaterial)->reflection = kPredefinedMaterials[predefinedMaterial].reflection;
+    (*pMaterial)->transmission = kPredefinedMaterials[predefinedMaterial].transmission;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarDestroyMaterial(nvarMaterial_t material) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validMaterial(material)) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    nvar_t nvar = material->nvar;
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    if (material->meshRefs > 0) {
+        return NVAR_STATUS_NOT_SUPPORTED;
+    }
+    nvar->materials.erase(material);
+    material->magic = kDeadMagic;
+    delete material;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetMaterialReflection(nvarMaterial_t material, float* pReflection) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validMaterial(material) || pReflection == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(material->nvar->lock);
+    *pReflection = material->reflection;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarSetMaterialReflection(nvarMaterial_t material, const float reflection) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validMaterial(material) || !(reflection >= NVAR_MIN_MATERIAL_COEFFICIENT && reflection <= NVAR_MAX_MATERIAL_COEFFICIENT)) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(material->nvar->lock);
+    material->reflection = reflection;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetMaterialTransmission(nvarMaterial_t material, float* pTransmission) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validMaterial(material) || pTransmission == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(material->nvar->lock);
+    *pTransmission = material->transmission;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarSetMaterialTransmission(nvarMaterial_t material, const float transmission) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validMaterial(material) || !(transmission >= NVAR_MIN_MATERIAL_COEFFICIENT && transmission <= NVAR_MAX_MATERIAL_COEFFICIENT)) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(material->nvar->lock);
+    material->transmission = transmission;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarCreateMesh(nvar_t nvar, nvarMesh_t* pMesh,
+               const nvarMatrix4x4_t transform,
+               const nvarFloat3_t vertices[],
+               const int numVertices,
+               const int faces[], const int numFaces,
+               nvarMaterial_t material) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar) || pMesh == nullptr || vertices == nullptr || faces == nullptr ||
+        numVertices <= 0 || numFaces <= 0 || !validMaterial(material) || material->nvar != nvar) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    for (int i = 0; i < numFaces * 3; i++) {
+        if (faces[i] < 0 || faces[i] >= numVertices) {
+            return NVAR_STATUS_INVALID_VALUE;
+        }
+    }
+
+    nvarMesh_t mesh = new nvarMesh_st();
+    mesh->magic = kMeshMagic;
+    mesh->nvar = nvar;
+    mesh->transform = transform;
+    mesh->vertices.resize(numVertices);
+    for (int i = 0; i < numVertices; i++) {
+        mesh->vertices[i] = Vec3(vertices[i]);
+    }
+    mesh->faces.assign(faces, faces + numFaces * 3);
+    mesh->material = material;
+
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    material->meshRefs++;
+    nvar->meshes.push_back(mesh);
+    nvar->geometryDirty = true;
+    *pMesh = mesh;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarDestroyMesh(nvarMesh_t mesh) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validMesh(mesh)) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    nvar_t nvar = mesh->nvar;
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    std::vector<nvarMesh_t>::iterator it = std::find(nvar->meshes.begin(), nvar->meshes.end(), mesh);
+    if (it != nvar->meshes.end()) {
+        *it = nvar->meshes.back();
+        nvar->meshes.pop_back();
+    }
+    mesh->material->meshRefs--;
+    nvar->geometryDirty = true;
+    mesh->magic = kDeadMagic;
+    delete mesh;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetMeshMaterial(nvarMesh_t mesh, nvarMaterial_t* pMaterial) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validMesh(mesh) || pMaterial == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(mesh->nvar->lock);
+    *pMaterial = mesh->material;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarSetMeshMaterial(nvarMesh_t mesh, nvarMaterial_t material) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validMesh(mesh) || !validMaterial(material) || material->nvar != mesh->nvar) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(mesh->nvar->lock);
+    mesh->material->meshRefs--;
+    material->meshRefs++;
+    mesh->material = material;
+    mesh->nvar->geometryDirty = true;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetMeshTransform(nvarMesh_t mesh, nvarMatrix4x4_t* pTransform) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validMesh(mesh) || pTransform == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(mesh->nvar->lock);
+    *pTransform = mesh->transform;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarSetMeshTransform(nvarMesh_t mesh, nvarMatrix4x4_t transform) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validMesh(mesh)) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(mesh->nvar->lock);
+    mesh->transform = transform;
+    mesh->nvar->geometryDirty = true;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarCreateSource(nvar_t nvar, nvarEffect_t effect, nvarSource_t* pSource) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar) || pSource == nullptr || effect < 0 || effect >= NVAR_NUM_EFFECT_PRESETS) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    nvarSource_t source = new nvarSource_st();
+    source->magic = kSourceMagic;
+    source->nvar = nvar;
+    source->effect = effect;
+    source->directPathGain.store(NVAR_DEFAULT_DIRECT_PATH_GAIN);
+    source->indirectPathGain.store(NVAR_DEFAULT_INDIRECT_PATH_GAIN);
+    source->latest = nullptr;
+    source->pending.store(nullptr);
+    source->inUse.store(nullptr);
+    source->claiming.store(nullptr);
+    source->partitionSize.store(0);
+    source->active = nullptr;
+    source->submitSamples = 0;
+
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    source->seed = nvar->nextSourceSeed++;
+    nvar->sources.push_back(source);
+    nvar->liveSources.insert(source);
+    *pSource = source;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarDestroySource(nvarSource_t source) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validSource(source)) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    nvar_t nvar = source->nvar;
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    std::vector<nvarSource_t>::iterator it = std::find(nvar->sources.begin(), nvar->sources.end(), source);
+    if (it != nvar->sources.end()) {
+        *it = nvar->sources.back();
+        nvar->sources.pop_back();
+    }
+    nvar->liveSources.erase(source);
+    source->magic = kDeadMagic;
+    if (nvar->busy) {
+        // the worker may still be tracing it, free after the current command
+        nvar->graveyard.push_back(source);
+    } else {
+        delete source;
+    }
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetSourceLocation(nvarSource_t source, nvarFloat3_t* pLocation) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validSource(source) || pLocation == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(source->nvar->lock);
+    *pLocation = source->location.toNvar();
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarSetSourceLocation(nvarSource_t source, nvarFloat3_t location) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validSource(source)) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(source->nvar->lock);
+    source->location = Vec3(location);
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetSourceIndirectPathGain(nvarSource_t source, float* pGain) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validSource(source) || pGain == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    *pGain = source->indirectPathGain.load();
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarSetSourceIndirectPathGain(nvarSource_t source, const float gain) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validSource(source) || !(gain >= 0.0f)) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    source->indirectPathGain.store(gain);
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetSourceEffectPreset(nvarSource_t source, nvarEffect_t* effectPreset) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validSource(source) || effectPreset == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(source->nvar->lock);
+    *effectPreset = source->effect;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarSetSourceEffectPreset(nvarSource_t source, nvarEffect_t effectPreset) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validSource(source) || effectPreset < 0 || effectPreset >= NVAR_NUM_EFFECT_PRESETS) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(source->nvar->lock);
+    source->effect = effectPreset;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetSourceDirectPathGain(nvarSource_t source, float* pGain) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validSource(source) || pGain == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    *pGain = source->directPathGain.load();
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarSetSourceDirectPathGain(nvarSource_t source, const float gain) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validSource(source) || !(gain >= 0.0f)) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    source->directPathGain.store(gain);
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarApplySourceFilters(nvarSource_t source, float** pOut, const float* pIn, const int numSamples) {
+    return applyFilters(source, pOut, pIn, numSamples, true, true);
+}
+
+nvarStatus_t NVAR_API
+nvarGetSourceFilterArraySize(nvar_t nvar, int* pFilterArraySize) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar) || pFilterArraySize == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    *pFilterArraySize = kChannels * filterLength(nvar) * (int)sizeof(float);
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetSourceFilters(nvarSource_t source, float filterArray[]) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validSource(source) || filterArray == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    nvar_t nvar = source->nvar;
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    if (source->latest == nullptr) {
+        return NVAR_STATUS_NOT_READY;
+    }
+    source->latest->render(filterArray, kChannels * filterLength(nvar));
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarApplySourceDirectPathFilter(nvarSource_t source, float** pOut, const float* pIn, const int numSamples) {
+    return applyFilters(source, pOut, pIn, numSamples, true, false);
+}
+
+nvarStatus_t NVAR_API
+nvarApplySourceIndirectPathFilter(nvarSource_t source, float** pOut, const float* pIn, const int numSamples) {
+    return applyFilters(source, pOut, pIn, numSamples, false, true);
+}
+
+nvarStatus_t NVAR_API
+nvarSourceSubmitBuffers(nvarSource_t source, const float* pIn, const int numSamples) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validSource(source) || pIn == nullptr || numSamples <= 0) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    nvar_t nvar = source->nvar;
+    int slot = nvar->submitCount.fetch_add(1);
+    if (slot >= kMaxSubmittedSources) {
+        nvar->submitCount.fetch_sub(1);
+        return NVAR_STATUS_OUT_OF_RESOURCES;
+    }
+    if ((int)source->submitBuffer.size() < numSamples) {
+        source->submitBuffer.resize(numSamples);
+    }
+    std::memcpy(source->submitBuffer.data(), pIn, numSamples * sizeof(float));
+    source->submitSamples = numSamples;
+    nvar->submitted[slot] = source;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarApplyIndirectPathFiltersToSubmittedBuffers(nvar_t nvar, float** pOut, const int numSamples) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar) || pOut == nullptr || numSamples <= 0) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    for (int ch = 0; ch < kChannels; ch++) {
+        if (pOut[ch] == nullptr) {
+            return NVAR_STATUS_INVALID_VALUE;
+        }
+    }
+    int count = std::min(nvar->submitCount.load(), kMaxSubmittedSources);
+    if (count == 0) {
+        return NVAR_STATUS_NOT_READY;
+    }
+
+    for (int ch = 0; ch < kChannels; ch++) {
+        std::fill(pOut[ch], pOut[ch] + numSamples, 0.0f);
+    }
+
+    // power of two blocks mix in the frequency domain and share the inverse transforms
+    SpectrumMix& mix = nvar->submitMix;
+    bool spectral = numSamples >= 32 && (numSamples & (numSamples - 1)) == 0;
+    bool mixed = false;
+    if (spectral) {
+        mix.prepare(numSamples);
+        mix.clear();
+    }
+    float* accRe[kChannels] = { nullptr, nullptr };
+    float* accIm[kChannels] = { nullptr, nullptr };
+    if (spectral) {
+        for (int ch = 0; ch < kChannels; ch++) {
+            accRe[ch] = mix.re[ch].data();
+            accIm[ch] = mix.im[ch].data();
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        nvarSource_t source = nvar->submitted[i];
+        if (!validSource(source) || source->submitSamples != numSamples) {
+            continue;
+        }
+        const SourceFilters* filters = acquireFilters(source);
+        float gain = source->indirectPathGain.load();
+        const float* in = source->submitBuffer.data();
+        if (spectral && source->indirectRenderer.accumulateSpectrum(filters, gain, in, numSamples, accRe, accIm)) {
+            mixed = true;
+        } else {
+            source->indirectRenderer.process(filters, gain, in, numSamples, pOut, true);
+        }
+        source->partitionSize.store(source->indirectRenderer.getPartitionSize());
+    }
+    if (mixed) {
+        mix.inverse(pOut);
+    }
+    nvar->submitCount.store(0);
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetSourceOcclusionSettings(nvarSource_t source, float* pOcclusionAttenuation, float* pDistanceAttenuation) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validSource(source) || pOcclusionAttenuation == nullptr || pDistanceAttenuation == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(source->nvar->lock);
+    if (source->latest == nullptr) {
+        *pOcclusionAttenuation = 1.0f;
+        *pDistanceAttenuation = 1.0f;
+    } else {
+        *pOcclusionAttenuation = source->latest->direct.occlusion;
+        *pDistanceAttenuation = source->latest->direct.distanceAttenuation;
+    }
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarGetSourceDetails(nvarSource_t source, nvarSourceDetails_t* details) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validSource(source) || details == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(source->nvar->lock);
+    if (source->latest == nullptr) {
+        return NVAR_STATUS_NOT_READY;
+    }
+    const DirectPath& direct = source->latest->direct;
+    details->sourceToListener = direct.sourceToListener.toNvar();
+    details->distance = direct.distance;
+    details->azimuth = direct.azimuth;
+    details->elevation = direct.elevation;
+    details->occlusionAttenuation = direct.occlusion;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarCPUCreateEvent(HANDLE* pEvent) {
+    if (pEvent == nullptr) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    Event* event = new Event();
+    event->magic = kEventMagic;
+    event->signaled = false;
+    *pEvent = event;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarCPUDestroyEvent(HANDLE hEvent) {
+    if (!validEvent(hEvent)) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    Event* event = static_cast<Event*>(hEvent);
+    event->magic = kDeadMagic;
+    delete event;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarCPUWaitEvent(HANDLE hEvent, int timeoutMs) {
+    if (!validEvent(hEvent)) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    Event* event = static_cast<Event*>(hEvent);
+    std::unique_lock<std::mutex> guard(event->lock);
+    if (timeoutMs < 0) {
+        event->cv.wait(guard, [event] { return event->signaled; });
+    } else if (!event->cv.wait_for(guard, std::chrono::milliseconds(timeoutMs), [event] { return event->signaled; })) {
+        return NVAR_STATUS_NOT_READY;
+    }
+    event->signaled = false;
+    return NVAR_STATUS_SUCCESS;
+}
+
+nvarStatus_t NVAR_API
+nvarCPUSetThreadCount(nvar_t nvar, int threadCount) {
+    NVAR_CHECK_INITIALIZED();
+    if (!validContext(nvar) || threadCount < 0) {
+        return NVAR_STATUS_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> guard(nvar->lock);
+    nvar->threadCount = threadCount;
+    return NVAR_STATUS_SUCCESS;
+}
+
+} // extern "C"
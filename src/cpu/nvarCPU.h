@@ -0,0 +1,48 @@
+/*
+ * CPU reference backend for the NVAR API.
+ *
+ * Implements the entry points declared in nvar.h (and nvarSourceDetails from
+ * nvarNDA.h) on the CPU so the wrapper can be built, run and profiled on
+ * machines without nvar.lib or an NVIDIA GPU. Traces run on a per-context
+ * command queue thread and are split across a pool of worker threads; ray
+ * casts use a SAH bounding volume hierarchy over the committed meshes.
+ *
+ * Traces signal portable event handles instead of Windows events. Handles
+ * passed to nvarTraceAudio and nvarEventRecord must come from
+ * nvarCPUCreateEvent.
+ */
+
+#ifndef GODOTNVAR_NVAR_CPU_H
+#define GODOTNVAR_NVAR_CPU_H
+
+#include "nvar.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Creates an auto-reset event usable as a trace done event **/
+nvarStatus_t NVAR_API
+nvarCPUCreateEvent(HANDLE* pEvent);
+
+/** Destroys an event created by nvarCPUCreateEvent **/
+nvarStatus_t NVAR_API
+nvarCPUDestroyEvent(HANDLE hEvent);
+
+/** Waits up to timeoutMs milliseconds (negative waits forever) for the
+ *  event to be signaled. Returns NVAR_STATUS_NOT_READY on timeout.
+ */
+nvarStatus_t NVAR_API
+nvarCPUWaitEvent(HANDLE hEvent, int timeoutMs);
+
+/** Sets the number of trace worker threads, 0 uses one per core. Takes
+ *  effect on the next trace.
+ */
+nvarStatus_t NVAR_API
+nvarCPUSetThreadCount(nvar_t nvar, int threadCount);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GODOTNVAR_NVAR_CPU_H
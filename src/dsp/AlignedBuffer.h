@@ -0,0 +1,55 @@
+#ifndef GODOTNVAR_DSP_ALIGNED_BUFFER_H
+#define GODOTNVAR_DSP_ALIGNED_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace dsp {
+
+/** Fixed-size float buffer aligned for SIMD loads. Allocates only in
+ *  allocate(), so it can be sized up front and used on the audio thread.
+ */
+class AlignedBuffer {
+public:
+    static const size_t kAlignment = 64;
+
+    AlignedBuffer() : raw(nullptr), data(nullptr), count(0) { }
+    explicit AlignedBuffer(size_t n) : raw(nullptr), data(nullptr), count(0) { allocate(n); }
+    ~AlignedBuffer() { std::free(raw); }
+
+    AlignedBuffer(const AlignedBuffer&) = delete;
+    AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+    /** Allocates n zeroed floats, releasing any previous storage **/
+    void allocate(size_t n) {
+        std::free(raw);
+        raw = std::malloc(n * sizeof(float) + kAlignment);
+        uintptr_t address = reinterpret_cast<uintptr_t>(raw);
+        data = reinterpret_cast<float*>((address + kAlignment - 1) & ~(uintptr_t)(kAlignment - 1));
+        count = n;
+        clear();
+    }
+
+    void clear() {
+        if (count > 0) {
+            std::memset(data, 0, count * sizeof(float));
+        }
+    }
+
+    float* get() { return data; }
+    const float* get() const { return data; }
+    size_t size() const { return count; }
+    float& operator[](size_t i) { return data[i]; }
+    const float& operator[](size_t i) const { return data[i]; }
+
+private:
+    void* raw;
+    float* data;
+    size_t count;
+};
+
+} // namespace dsp
+
+#endif // GODOTNVAR_DSP_ALIGNED_BUFFER_H
@@ -0,0 +1,47 @@
+#ifndef GODOTNVAR_DSP_ENERGY_DECAY_H
+#define GODOTNVAR_DSP_ENERGY_DECAY_H
+
+#include <cmath>
+
+namespace dsp {
+
+/** Returns how many leading taps of a multichannel filter to keep so that
+ *  the energy of everything cut off stays floorDb below the total energy,
+ *  using Schroeder backward integration over all channels together.
+ *  Channel c starts at filters + c * length. A floor of 0 dB or above keeps
+ *  the whole filter; a silent filter returns 0.
+ */
+inline int energyDecayLength(const float* filters, int channels, int length, float floorDb) {
+    if (floorDb >= 0.0f || length <= 0) {
+        return length;
+    }
+    double total = 0.0;
+    for (int ch = 0; ch < channels; ch++) {
+        const float* filter = filters + (size_t)ch * length;
+        for (int n = 0; n < length; n++) {
+            total += (double)filter[n] * filter[n];
+        }
+    }
+    if (total <= 0.0) {
+        return 0;
+    }
+
+    double threshold = total * std::pow(10.0, floorDb / 10.0);
+    double remaining = 0.0;
+    for (int n = length - 1; n >= 0; n--) {
+        double energy = 0.0;
+        for (int ch = 0; ch < channels; ch++) {
+            float tap = filters[(size_t)ch * length + n];
+            energy += (double)tap * tap;
+        }
+        if (remaining + energy > threshold) {
+            return n + 1;
+        }
+        remaining += energy;
+    }
+    return 0;
+}
+
+} // namespace dsp
+
+#endif // GODOTNVAR_DSP_ENERGY_DECAY_H
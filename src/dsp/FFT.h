@@ -0,0 +1,162 @@
+#ifndef GODOTNVAR_DSP_FFT_H
+#define GODOTNVAR_DSP_FFT_H
+
+#include <cmath>
+#include <vector>
+
+#include "MathConstants.h"
+
+namespace dsp {
+
+/** Returns the smallest power of two that is >= n **/
+inline int nextPowerOfTwo(int n) {
+    int p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+/** Real-input radix-2 FFT of a fixed power-of-two size.
+ *  Spectra are stored split (separate real and imaginary arrays) with
+ *  size/2 + 1 bins, which is the layout the convolvers multiply in.
+ *  The inverse transform is scaled by 1/size so forward + inverse is identity.
+ */
+class RealFFT {
+public:
+    RealFFT() : size(0), half(0) { }
+
+    explicit RealFFT(int n) : size(0), half(0) {
+        init(n);
+    }
+
+    void init(int n) {
+        size = n;
+        half = n / 2;
+
+        bitReverse.resize(half);
+        int bits = 0;
+        while ((1 << bits) < half) {
+            bits++;
+        }
+        for (int i = 0; i < half; i++) {
+            int r = 0;
+            for (int b = 0; b < bits; b++) {
+                r |= ((i >> b) & 1) << (bits - 1 - b);
+            }
+            bitReverse[i] = r;
+        }
+
+        // twiddles for the half-size complex transform
+        twiddleRe.resize(half / 2 + 1);
+        twiddleIm.resize(half / 2 + 1);
+        for (int i = 0; i <= half / 2; i++) {
+            double a = -2.0 * kPi * i / half;
+            twiddleRe[i] = (float)std::cos(a);
+            twiddleIm[i] = (float)std::sin(a);
+        }
+
+        // twiddles used to split the packed half-size transform into a real spectrum
+        splitRe.resize(half + 1);
+        splitIm.resize(half + 1);
+        for (int k = 0; k <= half; k++) {
+            double a = -2.0 * kPi * k / size;
+            splitRe[k] = (float)std::cos(a);
+            splitIm[k] = (float)std::sin(a);
+        }
+
+        workRe.resize(half);
+        workIm.resize(half);
+    }
+
+    int getSize() const { return size; }
+    int getBins() const { return half + 1; }
+
+    /** Transforms `size` real samples into getBins() complex bins. **/
+    void forward(const float* in, float* outRe, float* outIm) {
+        for (int i = 0; i < half; i++) {
+            int r = bitReverse[i];
+            workRe[r] = in[2 * i];
+            workIm[r] = in[2 * i + 1];
+        }
+        transform();
+
+        // X[k] = Fe[k] + W^k Fo[k]
+        for (int k = 0; k <= half; k++) {
+            int a = k % half;
+            int b = (half - k) % half;
+            float zr = workRe[a], zi = workIm[a];
+            float cr = workRe[b], ci = -workIm[b];
+            float eRe = 0.5f * (zr + cr);
+            float eIm = 0.5f * (zi + ci);
+            // Fo = -i/2 (Z[k] - conj(Z[m-k]))
+            float oRe = 0.5f * (zi - ci);
+            float oIm = -0.5f * (zr - cr);
+            outRe[k] = eRe + splitRe[k] * oRe - splitIm[k] * oIm;
+            outIm[k] = eIm + splitRe[k] * oIm + splitIm[k] * oRe;
+        }
+    }
+
+    /** Transforms getBins() complex bins back into `size` real samples. **/
+    void inverse(const float* inRe, const float* inIm, float* out) {
+        for (int k = 0; k < half; k++) {
+            float xr = inRe[k], xi = inIm[k];
+            float cr = inRe[half - k], ci = -inIm[half - k];
+            float eRe = 0.5f * (xr + cr);
+            float eIm = 0.5f * (xi + ci);
+            // Fo = (X[k] - conj(X[m-k])) * conj(W^k) / 2
+            float dRe = 0.5f * (xr - cr);
+            float dIm = 0.5f * (xi - ci);
+            float oRe = dRe * splitRe[k] + dIm * splitIm[k];
+            float oIm = dIm * splitRe[k] - dRe * splitIm[k];
+            // Z = Fe + i Fo, conjugated so the forward kernel computes the inverse
+            int r = bitReverse[k];
+            workRe[r] = eRe - oIm;
+            workIm[r] = -(eIm + oRe);
+        }
+        transform();
+
+        float scale = 1.0f / half;
+        for (int i = 0; i < half; i++) {
+            out[2 * i] = workRe[i] * scale;
+            out[2 * i + 1] = -workIm[i] * scale;
+        }
+    }
+
+private:
+    /** In-place iterative radix-2 transform of the bit-reversed work buffers **/
+    void transform() {
+        for (int len = 2; len <= half; len <<= 1) {
+            int step = half / len;
+            int h = len / 2;
+            for (int i = 0; i < half; i += len) {
+                for (int j = 0; j < h; j++) {
+                    float wr = twiddleRe[j * step];
+                    float wi = twiddleIm[j * step];
+                    int a = i + j;
+                    int b = a + h;
+                    float tr = workRe[b] * wr - workIm[b] * wi;
+                    float ti = workRe[b] * wi + workIm[b] * wr;
+                    workRe[b] = workRe[a] - tr;
+                    workIm[b] = workIm[a] - ti;
+                    workRe[a] += tr;
+                    workIm[a] += ti;
+                }
+            }
+        }
+    }
+
+    int size;
+    int half;
+    std::vector<int> bitReverse;
+    std::vector<float> twiddleRe;
+    std::vector<float> twiddleIm;
+    std::vector<float> splitRe;
+    std::vector<float> splitIm;
+    std::vector<float> workRe;
+    std::vector<float> workIm;
+};
+
+} // namespace dsp
+
+#endif // GODOTNVAR_DSP_FFT_H
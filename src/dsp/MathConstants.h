@@ -0,0 +1,11 @@
+#ifndef GODOTNVAR_DSP_MATH_CONSTANTS_H
+#define GODOTNVAR_DSP_MATH_CONSTANTS_H
+
+namespace dsp {
+
+/** Pi, since MSVC's <cmath> only defines M_PI with _USE_MATH_DEFINES **/
+constexpr double kPi = 3.14159265358979323846;
+
+} // namespace dsp
+
+#endif // GODOTNVAR_DSP_MATH_CONSTANTS_H
@@ -0,0 +1,387 @@
+#ifndef GODOTNVAR_DSP_PARTITIONED_CONVOLVER_H
+#define GODOTNVAR_DSP_PARTITIONED_CONVOLVER_H
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "FFT.h"
+
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#include <immintrin.h>
+#define GODOTNVAR_DSP_AVX2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define GODOTNVAR_DSP_NEON 1
+#endif
+
+namespace dsp {
+
+/** acc += a * b over n split-complex bins. This is the inner loop of the
+ *  convolver, vectorized with AVX2+FMA or NEON when the compiler targets them.
+ */
+inline void complexMultiplyAccumulate(const float* aRe, const float* aIm,
+                                      const float* bRe, const float* bIm,
+                                      float* accRe, float* accIm, int n) {
+    int k = 0;
+#if defined(GODOTNVAR_DSP_AVX2)
+    for (; k + 8 <= n; k += 8) {
+        __m256 ar = _mm256_loadu_ps(aRe + k);
+        __m256 ai = _mm256_loadu_ps(aIm + k);
+        __m256 br = _mm256_loadu_ps(bRe + k);
+        __m256 bi = _mm256_loadu_ps(bIm + k);
+        __m256 re = _mm256_fmadd_ps(ar, br, _mm256_loadu_ps(accRe + k));
+        __m256 im = _mm256_fmadd_ps(ar, bi, _mm256_loadu_ps(accIm + k));
+        _mm256_storeu_ps(accRe + k, _mm256_fnmadd_ps(ai, bi, re));
+        _mm256_storeu_ps(accIm + k, _mm256_fmadd_ps(ai, br, im));
+    }
+#elif defined(GODOTNVAR_DSP_NEON)
+    for (; k + 4 <= n; k += 4) {
+        float32x4_t ar = vld1q_f32(aRe + k);
+        float32x4_t ai = vld1q_f32(aIm + k);
+        float32x4_t br = vld1q_f32(bRe + k);
+        float32x4_t bi = vld1q_f32(bIm + k);
+        float32x4_t re = vmlaq_f32(vld1q_f32(accRe + k), ar, br);
+        float32x4_t im = vmlaq_f32(vld1q_f32(accIm + k), ar, bi);
+        vst1q_f32(accRe + k, vmlsq_f32(re, ai, bi));
+        vst1q_f32(accIm + k, vmlaq_f32(im, ai, br));
+    }
+#endif
+    for (; k < n; k++) {
+        accRe[k] += aRe[k] * bRe[k] - aIm[k] * bIm[k];
+        accIm[k] += aRe[k] * bIm[k] + aIm[k] * bRe[k];
+    }
+}
+
+/** out += gain * in over n samples or bins **/
+inline void scaleAccumulate(const float* in, float gain, float* out, int n) {
+    int k = 0;
+#if defined(GODOTNVAR_DSP_AVX2)
+    __m256 g = _mm256_set1_ps(gain);
+    for (; k + 8 <= n; k += 8) {
+        _mm256_storeu_ps(out + k, _mm256_fmadd_ps(g, _mm256_loadu_ps(in + k), _mm256_loadu_ps(out + k)));
+    }
+#elif defined(GODOTNVAR_DSP_NEON)
+    float32x4_t g = vdupq_n_f32(gain);
+    for (; k + 4 <= n; k += 4) {
+        vst1q_f32(out + k, vmlaq_f32(vld1q_f32(out + k), g, vld1q_f32(in + k)));
+    }
+#endif
+    for (; k < n; k++) {
+        out[k] += gain * in[k];
+    }
+}
+
+/** out += from + (to - from) * w over n samples, with w rising linearly
+ *  from 1/n to 1. Fades between the outputs of an old and a new filter
+ *  within one block.
+ */
+inline void crossfadeAccumulate(const float* from, const float* to, float* out, int n) {
+    float step = 1.0f / n;
+    int k = 0;
+#if defined(GODOTNVAR_DSP_AVX2)
+    const __m256 lanes = _mm256_setr_ps(1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f);
+    const __m256 vstep = _mm256_set1_ps(step);
+    for (; k + 8 <= n; k += 8) {
+        __m256 w = _mm256_mul_ps(_mm256_add_ps(_mm256_set1_ps((float)k), lanes), vstep);
+        __m256 f = _mm256_loadu_ps(from + k);
+        __m256 faded = _mm256_fmadd_ps(_mm256_sub_ps(_mm256_loadu_ps(to + k), f), w, f);
+        _mm256_storeu_ps(out + k, _mm256_add_ps(_mm256_loadu_ps(out + k), faded));
+    }
+#elif defined(GODOTNVAR_DSP_NEON)
+    const float laneValues[4] = { 1.0f, 2.0f, 3.0f, 4.0f };
+    const float32x4_t lanes = vld1q_f32(laneValues);
+    for (; k + 4 <= n; k += 4) {
+        float32x4_t w = vmulq_n_f32(vaddq_f32(vdupq_n_f32((float)k), lanes), step);
+        float32x4_t f = vld1q_f32(from + k);
+        float32x4_t faded = vmlaq_f32(f, vsubq_f32(vld1q_f32(to + k), f), w);
+        vst1q_f32(out + k, vaddq_f32(vld1q_f32(out + k), faded));
+    }
+#endif
+    for (; k < n; k++) {
+        float w = (k + 1) * step;
+        out[k] += from[k] + (to[k] - from[k]) * w;
+    }
+}
+
+/** Frequency-domain partitions of one filter channel, ready for a
+ *  UniformConvolver with the same partition size. A default constructed
+ *  spectrum has no partitions and filters to silence.
+ */
+struct FilterSpectrum {
+    int partitionSize = 0;
+    int numPartitions = 0;
+    int bins = 0;
+    std::vector<float> re;
+    std::vector<float> im;
+    std::vector<int> active;   // partitions with any nonzero tap, the only ones multiplied
+
+    /** Splits `length` filter taps into partitions and transforms each one.
+     *  `fft` must have been initialized with 2 * partitionSize.
+     */
+    void build(RealFFT& fft, const float* filter, int length, int pSize) {
+        partitionSize = pSize;
+        numPartitions = std::max(1, (length + pSize - 1) / pSize);
+        bins = pSize + 1;
+        re.assign((size_t)numPartitions * bins, 0.0f);
+        im.assign((size_t)numPartitions * bins, 0.0f);
+        active.clear();
+
+        std::vector<float> block(2 * pSize);
+        for (int p = 0; p < numPartitions; p++) {
+            int start = p * pSize;
+            int count = std::min(pSize, length - start);
+            if (count <= 0 || std::all_of(filter + start, filter + start + count, [](float tap) { return tap == 0.0f; })) {
+                continue;
+            }
+            std::fill(block.begin(), block.end(), 0.0f);
+            std::memcpy(block.data(), filter + start, count * sizeof(float));
+            fft.forward(block.data(), &re[(size_t)p * bins], &im[(size_t)p * bins]);
+            active.push_back(p);
+        }
+    }
+};
+
+/** Uniformly partitioned overlap-save convolver. One input channel feeds any
+ *  number of filters through a shared frequency-domain delay line (FDL), so a
+ *  stereo filter costs one forward FFT and two inverse FFTs per block.
+ *  Every block is exactly getPartitionSize() samples; callers that need other
+ *  block sizes buffer around it.
+ */
+class UniformConvolver {
+public:
+    UniformConvolver() : partitionSize(0), maxPartitions(0), bins(0), head(0) { }
+
+    void init(int pSize, int partitions) {
+        partitionSize = pSize;
+        maxPartitions = std::max(1, partitions);
+        bins = pSize + 1;
+        fft.init(2 * pSize);
+        inputBlock.assign(2 * pSize, 0.0f);
+        fdlRe.assign((size_t)maxPartitions * bins, 0.0f);
+        fdlIm.assign((size_t)maxPartitions * bins, 0.0f);
+        accRe.assign(bins, 0.0f);
+        accIm.assign(bins, 0.0f);
+        timeOut.assign(2 * pSize, 0.0f);
+        fadeFrom.assign(pSize, 0.0f);
+        fadeTo.assign(pSize, 0.0f);
+        head = 0;
+    }
+
+    void reset() {
+        std::fill(inputBlock.begin(), inputBlock.end(), 0.0f);
+        std::fill(fdlRe.begin(), fdlRe.end(), 0.0f);
+        std::fill(fdlIm.begin(), fdlIm.end(), 0.0f);
+        head = 0;
+    }
+
+    int getPartitionSize() const { return partitionSize; }
+    int getMaxPartitions() const { return maxPartitions; }
+    int getBins() const { return bins; }
+    RealFFT& getFFT() { return fft; }
+
+    /** Shifts a new block of partitionSize samples into the delay line **/
+    void pushInput(const float* in) {
+        std::memmove(inputBlock.data(), inputBlock.data() + partitionSize, partitionSize * sizeof(float));
+        std::memcpy(inputBlock.data() + partitionSize, in, partitionSize * sizeof(float));
+        head = (head + maxPartitions - 1) % maxPartitions;
+        fft.forward(inputBlock.data(), &fdlRe[(size_t)head * bins], &fdlIm[(size_t)head * bins]);
+    }
+
+    /** Accumulates the spectrum of the current block filtered by `filter`
+     *  into accumulator bins, without transforming back.
+     */
+    void multiplyAccumulate(const FilterSpectrum& filter, float* outRe, float* outIm) const {
+        for (size_t i = 0; i < filter.active.size(); i++) {
+            int p = filter.active[i];
+            if (p >= maxPartitions) {
+                break;
+            }
+            size_t slot = (size_t)((head + p) % maxPartitions) * bins;
+            size_t part = (size_t)p * bins;
+            complexMultiplyAccumulate(&fdlRe[slot], &fdlIm[slot],
+                                      &filter.re[part], &filter.im[part],
+                                      outRe, outIm, bins);
+        }
+    }
+
+    /** Transforms accumulated bins back and writes (or adds) the valid half **/
+    void inverse(const float* inRe, const float* inIm, float* out, bool accumulate) {
+        fft.inverse(inRe, inIm, timeOut.data());
+        const float* valid = timeOut.data() + partitionSize;
+        if (accumulate) {
+            scaleAccumulate(valid, 1.0f, out, partitionSize);
+        } else {
+            std::memcpy(out, valid, partitionSize * sizeof(float));
+        }
+    }
+
+    /** Filters the most recently pushed block with `filter` **/
+    void convolve(const FilterSpectrum& filter, float* out, bool accumulate) {
+        std::fill(accRe.begin(), accRe.end(), 0.0f);
+        std::fill(accIm.begin(), accIm.end(), 0.0f);
+        multiplyAccumulate(filter, accRe.data(), accIm.data());
+        inverse(accRe.data(), accIm.data(), out, accumulate);
+    }
+
+    /** Filters the most recently pushed block with both filters and adds a
+     *  linear crossfade from the first to the second to `out`, so a filter
+     *  update does not click.
+     */
+    void crossfade(const FilterSpectrum& from, const FilterSpectrum& to, float* out) {
+        convolve(from, fadeFrom.data(), false);
+        convolve(to, fadeTo.data(), false);
+        crossfadeAccumulate(fadeFrom.data(), fadeTo.data(), out, partitionSize);
+    }
+
+private:
+    RealFFT fft;
+    int partitionSize;
+    int maxPartitions;
+    int bins;
+    int head;
+    std::vector<float> inputBlock;
+    std::vector<float> fdlRe;
+    std::vector<float> fdlIm;
+    std::vector<float> accRe;
+    std::vector<float> accIm;
+    std::vector<float> timeOut;
+    std::vector<float> fadeFrom;
+    std::vector<float> fadeTo;
+};
+
+/** Two-segment non-uniformly partitioned convolver for long filters.
+ *
+ *  The head of the filter, up to getTailOffset() taps, runs through a
+ *  UniformConvolver with short partitions on the calling thread, so latency
+ *  stays at one block. The rest runs through a second convolver with long
+ *  partitions, one tail block per getTailBlocks() head blocks, which a
+ *  background thread can compute while the caller keeps going:
+ *
+ *  - process() filters one head block and adds the tail output due for it.
+ *  - Once atTailBoundary(), the caller hands the collected input over with
+ *    beginTail(), and processTail() may run elsewhere until the next boundary.
+ *
+ *  The tail starts two tail blocks into the filter, which gives the worker a
+ *  whole tail period to finish.
+ */
+class NonUniformConvolver {
+public:
+    static const int kMaxChannels = 2;
+
+    NonUniformConvolver() : headSize(0), tailSize(0), channels(0), phase(0), current(0), handed(0) { }
+
+    /** filterLength is the longest filter the convolver will see **/
+    void init(int headBlock, int tailBlock, int numChannels, int filterLength) {
+        headSize = headBlock;
+        tailSize = tailBlock;
+        channels = std::min(numChannels, kMaxChannels);
+        int tailOffset = getTailOffset();
+        int headTaps = std::min(filterLength, tailOffset);
+        int tailTaps = std::max(0, filterLength - tailOffset);
+        headConvolver.init(headSize, (headTaps + headSize - 1) / headSize);
+        tailConvolver.init(tailSize, (tailTaps + tailSize - 1) / tailSize);
+        for (int i = 0; i < 2; i++) {
+            tailInput[i].assign(tailSize, 0.0f);
+            for (int ch = 0; ch < kMaxChannels; ch++) {
+                tailOutput[i][ch].assign(tailSize, 0.0f);
+            }
+        }
+        phase = 0;
+        current = 0;
+        handed = 0;
+    }
+
+    void reset() {
+        headConvolver.reset();
+        tailConvolver.reset();
+        for (int i = 0; i < 2; i++) {
+            std::fill(tailInput[i].begin(), tailInput[i].end(), 0.0f);
+            for (int ch = 0; ch < kMaxChannels; ch++) {
+                std::fill(tailOutput[i][ch].begin(), tailOutput[i][ch].end(), 0.0f);
+            }
+        }
+        phase = 0;
+        current = 0;
+        handed = 0;
+    }
+
+    int getHeadSize() const { return headSize; }
+    int getTailSize() const { return tailSize; }
+    int getTailBlocks() const { return tailSize / headSize; }
+    int getTailOffset() const { return 2 * tailSize; }
+
+    /** Filters one block of getHeadSize() samples and adds the result to
+     *  out[ch]. head may be null to only keep the delay lines running. If
+     *  fadeFrom is set, the head output crossfades from it to head.
+     */
+    void process(const float* in, const FilterSpectrum* head, const FilterSpectrum* fadeFrom, float* const* out) {
+        headConvolver.pushInput(in);
+        if (head) {
+            for (int ch = 0; ch < channels; ch++) {
+                if (fadeFrom) {
+                    headConvolver.crossfade(fadeFrom[ch], head[ch], out[ch]);
+                } else {
+                    headConvolver.convolve(head[ch], out[ch], true);
+                }
+            }
+        }
+        size_t offset = (size_t)phase * headSize;
+        std::memcpy(&tailInput[current][offset], in, headSize * sizeof(float));
+        for (int ch = 0; ch < channels; ch++) {
+            scaleAccumulate(&tailOutput[current][ch][offset], 1.0f, out[ch], headSize);
+        }
+        phase++;
+    }
+
+    bool atTailBoundary() const { return phase == getTailBlocks(); }
+
+    /** Joins a stream in the middle of a tail period, as if `blocks` blocks
+     *  of silence had already been processed. Only valid right after reset().
+     */
+    void skipBlocks(int blocks) {
+        phase = std::min(blocks, getTailBlocks());
+    }
+
+    /** Hands the tail block collected since the last boundary to processTail() **/
+    void beginTail() {
+        handed = current;
+        current ^= 1;
+        phase = 0;
+    }
+
+    /** Filters the handed tail block. Output is played two tail periods after
+     *  the block was collected. tail may be null for silence. If fadeFrom is
+     *  set, the tail block crossfades from it to tail.
+     */
+    void processTail(const FilterSpectrum* tail, const FilterSpectrum* fadeFrom) {
+        tailConvolver.pushInput(tailInput[handed].data());
+        for (int ch = 0; ch < channels; ch++) {
+            std::vector<float>& out = tailOutput[handed][ch];
+            if (tail && fadeFrom) {
+                std::fill(out.begin(), out.end(), 0.0f);
+                tailConvolver.crossfade(fadeFrom[ch], tail[ch], out.data());
+            } else if (tail) {
+                tailConvolver.convolve(tail[ch], out.data(), false);
+            } else {
+                std::fill(out.begin(), out.end(), 0.0f);
+            }
+        }
+    }
+
+private:
+    UniformConvolver headConvolver;
+    UniformConvolver tailConvolver;
+    int headSize;
+    int tailSize;
+    int channels;
+    int phase;     // head blocks collected in the current tail period
+    int current;   // tail buffers the caller is filling and playing
+    int handed;    // tail buffers owned by processTail()
+    std::vector<float> tailInput[2];
+    std::vector<float> tailOutput[2][kMaxChannels];
+};
+
+} // namespace dsp
+
+#endif // GODOTNVAR_DSP_PARTITIONED_CONVOLVER_H
@@ -0,0 +1,79 @@
+#ifndef GODOTNVAR_DSP_RING_BUFFER_H
+#define GODOTNVAR_DSP_RING_BUFFER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#include "FFT.h"
+
+namespace dsp {
+
+/** Lock-free single producer, single consumer FIFO of trivially copyable
+ *  values. Capacity is rounded up to a power of two and allocated once in
+ *  init().
+ */
+template <class T>
+class BasicRingBuffer {
+public:
+    BasicRingBuffer() : mask(0), readPos(0), writePos(0) { }
+
+    /** Not thread safe, call before either side starts using the buffer **/
+    void init(int capacity) {
+        int size = nextPowerOfTwo(std::max(2, capacity));
+        buffer.assign(size, T());
+        mask = size - 1;
+        readPos.store(0);
+        writePos.store(0);
+    }
+
+    int capacity() const { return (int)buffer.size(); }
+
+    int readAvailable() const {
+        return (int)(writePos.load(std::memory_order_acquire) - readPos.load(std::memory_order_relaxed));
+    }
+
+    int writeAvailable() const {
+        return capacity() - (int)(writePos.load(std::memory_order_relaxed) - readPos.load(std::memory_order_acquire));
+    }
+
+    /** Producer side. Writes up to count samples, returns how many fit. **/
+    int write(const T* in, int count) {
+        unsigned w = writePos.load(std::memory_order_relaxed);
+        count = std::min(count, writeAvailable());
+        int first = std::min(count, (int)(buffer.size() - (w & mask)));
+        std::memcpy(&buffer[w & mask], in, first * sizeof(T));
+        std::memcpy(&buffer[0], in + first, (count - first) * sizeof(T));
+        writePos.store(w + count, std::memory_order_release);
+        return count;
+    }
+
+    /** Consumer side. Reads up to count samples, returns how many were read. **/
+    int read(T* out, int count) {
+        unsigned r = readPos.load(std::memory_order_relaxed);
+        count = std::min(count, readAvailable());
+        int first = std::min(count, (int)(buffer.size() - (r & mask)));
+        std::memcpy(out, &buffer[r & mask], first * sizeof(T));
+        std::memcpy(out + first, &buffer[0], (count - first) * sizeof(T));
+        readPos.store(r + count, std::memory_order_release);
+        return count;
+    }
+
+    /** Consumer side. Drops everything currently buffered. **/
+    void discard() {
+        readPos.store(writePos.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+private:
+    std::vector<T> buffer;
+    unsigned mask;
+    std::atomic<unsigned> readPos;
+    std::atomic<unsigned> writePos;
+};
+
+typedef BasicRingBuffer<float> RingBuffer;
+
+} // namespace dsp
+
+#endif // GODOTNVAR_DSP_RING_BUFFER_H
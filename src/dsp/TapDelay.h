@@ -0,0 +1,163 @@
+#ifndef GODOTNVAR_DSP_TAP_DELAY_H
+#define GODOTNVAR_DSP_TAP_DELAY_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "PartitionedConvolver.h"
+
+namespace dsp {
+
+/** out += a * x0 + b * x1 over n samples. One linearly interpolated tap of
+ *  a multi-tap delay line, vectorized like the convolver kernels.
+ */
+inline void twoTapAccumulate(const float* x0, const float* x1, float a, float b, float* out, int n) {
+    int k = 0;
+#if defined(GODOTNVAR_DSP_AVX2)
+    __m256 va = _mm256_set1_ps(a);
+    __m256 vb = _mm256_set1_ps(b);
+    for (; k + 8 <= n; k += 8) {
+        __m256 acc = _mm256_fmadd_ps(va, _mm256_loadu_ps(x0 + k), _mm256_loadu_ps(out + k));
+        _mm256_storeu_ps(out + k, _mm256_fmadd_ps(vb, _mm256_loadu_ps(x1 + k), acc));
+    }
+#elif defined(GODOTNVAR_DSP_NEON)
+    float32x4_t va = vdupq_n_f32(a);
+    float32x4_t vb = vdupq_n_f32(b);
+    for (; k + 4 <= n; k += 4) {
+        float32x4_t acc = vmlaq_f32(vld1q_f32(out + k), va, vld1q_f32(x0 + k));
+        vst1q_f32(out + k, vmlaq_f32(acc, vb, vld1q_f32(x1 + k)));
+    }
+#endif
+    for (; k < n; k++) {
+        out[k] += a * x0[k] + b * x1[k];
+    }
+}
+
+/** One fractional delay tap: gain at `delay` samples and gainNext at
+ *  delay + 1, which is how a linearly interpolated impulse lands in a filter.
+ */
+struct Tap {
+    int delay;
+    float gain;
+    float gainNext;
+};
+
+/** Sparse taps pulled out of the start of a filter **/
+struct TapSet {
+    std::vector<Tap> taps;
+    int length = 0;   // filter taps covered, the rest is left to the convolver
+
+    /** Moves the sparse start of a filter into taps. Whole partitions of
+     *  partitionSize are taken from the front, up to maxLength samples, as
+     *  long as each costs fewer taps than tapsPerPartition on average and
+     *  maxTaps is not exceeded. Samples with a magnitude at or below floor
+     *  count as silence. Covered samples are zeroed in filter, so the
+     *  convolver skips those partitions. Returns the covered length.
+     */
+    int extract(float* filter, int filterLength, int partitionSize, int maxLength,
+                float floor, int maxTaps, int tapsPerPartition) {
+        taps.clear();
+        length = 0;
+        int limit = std::min(filterLength, maxLength);
+        std::vector<Tap> candidate;
+        int bestSaving = 0;
+        size_t bestCount = 0;
+        int partitions = 0;
+        for (int start = 0; start + partitionSize <= limit; start += partitionSize) {
+            int end = start + partitionSize;
+            for (int n = start; n < end; n++) {
+                if (std::fabs(filter[n]) <= floor) {
+                    continue;
+                }
+                Tap tap;
+                tap.delay = n;
+                tap.gain = filter[n];
+                tap.gainNext = 0.0f;
+                if (n + 1 < end && std::fabs(filter[n + 1]) > floor) {
+                    tap.gainNext = filter[n + 1];
+                    n++;
+                }
+                candidate.push_back(tap);
+            }
+            if ((int)candidate.size() > maxTaps) {
+                break;
+            }
+            partitions++;
+            int saving = partitions * tapsPerPartition - (int)candidate.size();
+            if (saving > bestSaving) {
+                bestSaving = saving;
+                bestCount = candidate.size();
+                length = end;
+            }
+        }
+        if (length == 0) {
+            return 0;
+        }
+
+        taps.assign(candidate.begin(), candidate.begin() + bestCount);
+        std::fill(filter, filter + length, 0.0f);
+        return length;
+    }
+};
+
+/** Renders TapSets against a shared mono delay line, one block at a time **/
+class MultiTapDelay {
+public:
+    MultiTapDelay() : blockSize(0), maxDelay(0) { }
+
+    /** maxDelay is the longest TapSet::length that will be rendered **/
+    void init(int blockSize, int maxDelay) {
+        this->blockSize = blockSize;
+        this->maxDelay = maxDelay;
+        history.assign((size_t)maxDelay + 1 + blockSize, 0.0f);
+        fadeFrom.assign(blockSize, 0.0f);
+        fadeTo.assign(blockSize, 0.0f);
+    }
+
+    void reset() {
+        std::fill(history.begin(), history.end(), 0.0f);
+    }
+
+    int getMaxDelay() const { return maxDelay; }
+
+    /** Shifts a new block of blockSize samples into the delay line **/
+    void pushInput(const float* in) {
+        size_t past = (size_t)maxDelay + 1;
+        std::memmove(history.data(), history.data() + blockSize, past * sizeof(float));
+        std::memcpy(history.data() + past, in, blockSize * sizeof(float));
+    }
+
+    /** Adds the latest block filtered by taps to out **/
+    void process(const TapSet& set, float* out) const {
+        const float* now = history.data() + maxDelay + 1;
+        for (size_t i = 0; i < set.taps.size(); i++) {
+            const Tap& tap = set.taps[i];
+            if (tap.delay >= maxDelay) {
+                continue;
+            }
+            twoTapAccumulate(now - tap.delay, now - tap.delay - 1, tap.gain, tap.gainNext, out, blockSize);
+        }
+    }
+
+    /** Adds a linear crossfade from one tap set to another to out **/
+    void crossfade(const TapSet& from, const TapSet& to, float* out) {
+        std::fill(fadeFrom.begin(), fadeFrom.end(), 0.0f);
+        std::fill(fadeTo.begin(), fadeTo.end(), 0.0f);
+        process(from, fadeFrom.data());
+        process(to, fadeTo.data());
+        crossfadeAccumulate(fadeFrom.data(), fadeTo.data(), out, blockSize);
+    }
+
+private:
+    int blockSize;
+    int maxDelay;
+    std::vector<float> history;   // maxDelay + 1 past samples, then the latest block
+    std::vector<float> fadeFrom;
+    std::vector<float> fadeTo;
+};
+
+} // namespace dsp
+
+#endif // GODOTNVAR_DSP_TAP_DELAY_H